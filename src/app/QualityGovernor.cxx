@@ -0,0 +1,66 @@
+#include <algorithm> // for max, min
+
+#include "QualityGovernor.hxx"
+
+QualityGovernor::QualityGovernor(double targetFps) {
+  SetTargetFps(targetFps);
+}
+
+void QualityGovernor::SetTargetFps(double fps) {
+  this->targetFps = std::max(fps, 1.0);
+}
+
+double QualityGovernor::GetTargetFps() {
+  return this->targetFps;
+}
+
+void QualityGovernor::NoteInteraction() {
+  this->interacting = true;
+  this->lastInteraction = Clock::now();
+}
+
+void QualityGovernor::BeginInteraction() {
+  this->dragging = true;
+  NoteInteraction();
+}
+
+void QualityGovernor::EndInteraction() {
+  this->dragging = false;
+  NoteInteraction();
+}
+
+void QualityGovernor::RecordFrame(double seconds) {
+  if (!this->interacting || seconds <= 0) {
+    return;
+  }
+  // Damped, so single slow frames (e.g. a swapped in timestep) do not
+  // throw the quality away
+  double ratio = (1.0 / this->targetFps) / seconds;
+  ratio = std::max(0.5, std::min(ratio, 1.5));
+  this->interactiveQuality =
+      std::max(this->minQuality, std::min(this->interactiveQuality * ratio, 1.0));
+}
+
+bool QualityGovernor::Update() {
+  if (this->interacting && !this->dragging) {
+    double idle = std::chrono::duration<double>(Clock::now() -
+                                                this->lastInteraction)
+                      .count();
+    if (idle > this->idleSeconds) {
+      this->interacting = false;
+    }
+  }
+
+  double quality = GetQuality();
+  bool changed = quality != this->appliedQuality;
+  this->appliedQuality = quality;
+  return changed;
+}
+
+bool QualityGovernor::IsInteracting() {
+  return this->interacting;
+}
+
+double QualityGovernor::GetQuality() {
+  return this->interacting ? this->interactiveQuality : 1.0;
+}
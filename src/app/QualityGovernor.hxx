@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+
+/*
+  Decides the render quality while the camera moves. While the user
+  interacts (keys held or trackball dragged) the quality drops below 1 so
+  that frames take about 1 / targetFps: after every frame it is scaled by
+  how far the frame time was off. Once the camera was idle for idleSeconds
+  the full quality is restored.
+
+  The quality is a fraction of the full quality, what it means (particles
+  drawn, SPH sample distance) is up to the caller.
+*/
+class QualityGovernor {
+public:
+  explicit QualityGovernor(double targetFps = 30.0);
+
+  void SetTargetFps(double fps);
+  double GetTargetFps();
+
+  // The camera was moved (e.g. by a key press)
+  void NoteInteraction();
+  // The trackball is dragged between these, the camera never counts as idle
+  void BeginInteraction();
+  void EndInteraction();
+
+  // Duration of the last frame
+  void RecordFrame(double seconds);
+
+  // Ends the interaction once the camera was idle long enough, returns
+  // true if the quality changed since the last call
+  bool Update();
+
+  bool IsInteracting();
+  // 1 at rest, between minQuality and 1 while interacting
+  double GetQuality();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  double targetFps;
+  double idleSeconds = 0.3;
+  double minQuality = 0.02;
+
+  bool interacting = false;
+  bool dragging = false;
+  Clock::time_point lastInteraction;
+  // Kept between the interactions, so the next one starts where this one
+  // settled
+  double interactiveQuality = 0.5;
+  // The quality the caller saw at the last Update()
+  double appliedQuality = 1.0;
+};
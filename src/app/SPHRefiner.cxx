@@ -0,0 +1,123 @@
+#include <algorithm> // for copy
+#include <utility>
+
+#include <vtkImageData.h>
+#include <vtkPolyData.h>
+
+#include "../data/SpatialIndex.hxx"
+#include "SPHRefiner.hxx"
+
+SPHRefiner::SPHRefiner(std::vector<int> resolutions,
+                       const double volumeLengths[3]) {
+  this->resolutions = std::move(resolutions);
+
+  for (int resolution : this->resolutions) {
+    vtkSmartPointer<SPHSplatAlgorithm> splat =
+        vtkSmartPointer<SPHSplatAlgorithm>::New();
+    int dimensions[3] = {resolution, resolution, resolution};
+    splat->SetDimensions(dimensions);
+    splat->SetVolumeLengths(volumeLengths);
+    levels.push_back(splat);
+  }
+
+  worker = std::thread(&SPHRefiner::WorkerLoop, this);
+}
+
+SPHRefiner::~SPHRefiner() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    hasPending = false;
+  }
+  generation++;
+  requestAvailable.notify_all();
+  worker.join();
+}
+
+void SPHRefiner::Request(vtkSmartPointer<vtkPolyData> baryons,
+                         const double origin[3]) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    hasPending = true;
+    pendingBaryons = std::move(baryons);
+    std::copy(origin, origin + 3, pendingOrigin);
+    // A level of the previous request would show the old box
+    hasReady = false;
+    ready = SPHVolume();
+    generation++;
+  }
+  requestAvailable.notify_one();
+}
+
+bool SPHRefiner::TakeReady(SPHVolume &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!hasReady) {
+    return false;
+  }
+  out = std::move(ready);
+  ready = SPHVolume();
+  hasReady = false;
+  return true;
+}
+
+void SPHRefiner::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    requestAvailable.wait(lock, [this] { return stopping || hasPending; });
+    if (stopping) {
+      return;
+    }
+
+    vtkSmartPointer<vtkPolyData> baryons = std::move(pendingBaryons);
+    double origin[3];
+    std::copy(pendingOrigin, pendingOrigin + 3, origin);
+    uint64_t requestGeneration = generation;
+    hasPending = false;
+    lock.unlock();
+
+    // Shared by all levels, built once per timestep
+    if (baryons != indexedBaryons) {
+      indexedBaryons = baryons;
+      index = std::make_shared<const SpatialIndex>(
+          baryons, SpatialIndex::DefaultCellSize(baryons->GetNumberOfPoints()));
+    }
+
+    for (size_t l = 0; l < levels.size(); l++) {
+      if (requestGeneration != generation) {
+        break;
+      }
+
+      SPHSplatAlgorithm *splat = levels[l];
+      splat->SetAbortCheck(
+          [this, requestGeneration] { return requestGeneration != generation; });
+      splat->SetInputData(baryons);
+      splat->SetSpatialIndex(index);
+      splat->SetOrigin(origin);
+      splat->Update();
+      if (splat->WasAborted()) {
+        // Executes again on the next update instead of keeping the partial
+        // volume
+        splat->Modified();
+        break;
+      }
+
+      // The splat creates new scalars every execution, so the copy stays
+      // untouched by the next update of this level
+      SPHVolume volume;
+      volume.image = vtkSmartPointer<vtkImageData>::New();
+      volume.image->ShallowCopy(splat->GetOutput());
+      volume.resolution = resolutions[l];
+      volume.final = l + 1 == levels.size();
+
+      std::lock_guard<std::mutex> readyLock(mutex);
+      if (requestGeneration != generation) {
+        break;
+      }
+      ready = std::move(volume);
+      hasReady = true;
+    }
+
+    lock.lock();
+  }
+}
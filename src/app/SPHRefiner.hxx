@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+
+#include "../processing/SPHSplatAlgorithm.hxx"
+
+class SpatialIndex;
+class vtkImageData;
+class vtkPolyData;
+
+// One level of the progressive SPH volume
+struct SPHVolume {
+  vtkSmartPointer<vtkImageData> image;
+  // Voxels per axis
+  int resolution = 0;
+  // Whether no finer level follows
+  bool final = false;
+};
+
+/*
+  Splats the SPH volume progressively on a worker thread: first at the
+  coarsest resolution, which is ready almost immediately, then at every
+  finer one. The main thread swaps each level in with TakeReady().
+
+  A new request (moved box or new timestep) aborts the refinement of the
+  previous one, also in the middle of a level. Every level has its own
+  splat algorithm, so each keeps the voxels it can reuse when the box only
+  moved. The particles near the box are found with a spatial index of the
+  baryons, built by the worker once for every new timestep.
+*/
+class SPHRefiner {
+public:
+  // resolutions: voxels per axis of the levels, coarse to fine
+  SPHRefiner(std::vector<int> resolutions, const double volumeLengths[3]);
+  ~SPHRefiner();
+
+  // Splats the baryons in the box at origin, superseding earlier requests
+  void Request(vtkSmartPointer<vtkPolyData> baryons, const double origin[3]);
+
+  // Returns true and moves the finest level finished since the last call
+  // into out
+  bool TakeReady(SPHVolume &out);
+
+private:
+  std::vector<int> resolutions;
+  std::vector<vtkSmartPointer<SPHSplatAlgorithm>> levels;
+
+  // Incremented by every request, compared by the worker to notice that it
+  // was superseded
+  std::atomic<uint64_t> generation{0};
+
+  // Latest request and the finished level
+  std::mutex mutex;
+  std::condition_variable requestAvailable;
+  bool stopping = false;
+  bool hasPending = false;
+  vtkSmartPointer<vtkPolyData> pendingBaryons;
+  double pendingOrigin[3] = {0, 0, 0};
+  bool hasReady = false;
+  SPHVolume ready;
+  std::thread worker;
+
+  // Only used by the worker
+  vtkSmartPointer<vtkPolyData> indexedBaryons;
+  std::shared_ptr<const SpatialIndex> index;
+
+  void WorkerLoop();
+};
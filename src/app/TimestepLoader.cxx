@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdio.h>
+#include <utility>
+
+#include <vtkPolyData.h>
+
+#include "TimestepLoader.hxx"
+
+#include "../data/SnapshotCache.hxx"
+#include "../processing/InterpolateSnapshots.hxx"
+
+TimestepLoader::TimestepLoader(SnapshotCache *cache, std::vector<int> steps,
+                               ClusterTableLookup clusters) {
+  this->cache = cache;
+  this->steps = std::move(steps);
+  this->clusterLookup = std::move(clusters);
+
+  worker = std::thread(&TimestepLoader::WorkerLoop, this);
+}
+
+TimestepLoader::~TimestepLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    hasPending = false;
+  }
+  generation++;
+  requestAvailable.notify_all();
+  worker.join();
+}
+
+PreparedTimestep TimestepLoader::Prepare(double time) {
+  // Never superseded
+  return Prepare(time, UINT64_MAX);
+}
+
+bool TimestepLoader::IsSuperseded(uint64_t requestGeneration) {
+  return requestGeneration != UINT64_MAX && requestGeneration != generation;
+}
+
+PreparedTimestep TimestepLoader::Prepare(double time,
+                                         uint64_t requestGeneration) {
+  std::lock_guard<std::mutex> lock(prepareMutex);
+
+  int direction = lastTime < 0 ? 0 : (time > lastTime) - (time < lastTime);
+
+  // The snapshots at or before and after the time
+  auto next = std::upper_bound(steps.begin(), steps.end(), time);
+  int step = next == steps.begin() ? steps.front() : *(next - 1);
+  bool interpolate = next != steps.begin() && next != steps.end() &&
+                     time > static_cast<double>(step);
+  if (!interpolate) {
+    time = step;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  vtkSmartPointer<vtkPolyData> snapshot = cache->Get(step);
+  // Between the stages we check whether a newer step was requested
+  if (IsSuperseded(requestGeneration)) {
+    return PreparedTimestep();
+  }
+  if (interpolate) {
+    vtkSmartPointer<vtkPolyData> after = cache->Get(*next);
+    if (IsSuperseded(requestGeneration)) {
+      return PreparedTimestep();
+    }
+    double t = (time - step) / (*next - step);
+    snapshot = InterpolateSnapshots(snapshot, after, t, time);
+  }
+  auto loaded = std::chrono::steady_clock::now();
+  if (IsSuperseded(requestGeneration)) {
+    return PreparedTimestep();
+  }
+  lastTime = time;
+  cache->Prefetch(step, direction);
+
+  // Clusters of the snapshot at or before the time
+  if (step != clusterStep || clustersChanged.exchange(false)) {
+    clusterTable = clusterLookup(step);
+    clusterStep = step;
+    attributesFilter->Modified();
+  }
+  attributesFilter->SetClusterTable(clusterTable.get());
+  attributesFilter->SetComputeLogTemperature(logTemperature);
+  attributesFilter->SetSinglePrecision(singlePrecision);
+  bool baryons = needsBaryons;
+  attributesFilter->SetProduceBaryons(baryons);
+  attributesFilter->SetInputData(snapshot);
+  attributesFilter->Update();
+
+  // The filter reuses its output objects, so hand out copies which stay
+  // untouched when the next step is prepared.
+  PreparedTimestep prepared;
+  prepared.step = step;
+  prepared.time = time;
+  prepared.loadSeconds = std::chrono::duration<double>(loaded - start).count();
+  prepared.filterSeconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - loaded)
+                               .count();
+  prepared.particles = vtkSmartPointer<vtkPolyData>::New();
+  prepared.particles->ShallowCopy(attributesFilter->GetParticlesOutput());
+  prepared.stars = vtkSmartPointer<vtkPolyData>::New();
+  prepared.stars->ShallowCopy(attributesFilter->GetStarsOutput());
+  if (baryons) {
+    prepared.baryons = vtkSmartPointer<vtkPolyData>::New();
+    prepared.baryons->ShallowCopy(attributesFilter->GetBaryonsOutput());
+  }
+  prepared.typeBuckets = attributesFilter->GetTypeBuckets();
+
+  return prepared;
+}
+
+void TimestepLoader::Request(double time) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.requested++;
+    if (hasPending) {
+      stats.dropped++;
+    }
+    if (hasReady && ready.time != time) {
+      ready = PreparedTimestep();
+      hasReady = false;
+      stats.discarded++;
+    }
+    hasPending = true;
+    pendingTime = time;
+    pendingRequestTime = std::chrono::steady_clock::now();
+    generation++;
+  }
+  requestAvailable.notify_one();
+}
+
+bool TimestepLoader::TakeReady(PreparedTimestep &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!hasReady) {
+    return false;
+  }
+  out = std::move(ready);
+  ready = PreparedTimestep();
+  hasReady = false;
+  return true;
+}
+
+TimestepLoaderStats TimestepLoader::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+void TimestepLoader::InvalidateClusters() {
+  clustersChanged = true;
+}
+
+void TimestepLoader::SetComputeLogTemperature(bool compute) {
+  logTemperature = compute;
+}
+
+void TimestepLoader::SetSinglePrecision(bool single) {
+  singlePrecision = single;
+}
+
+void TimestepLoader::SetNeedsBaryons(bool needs) {
+  needsBaryons = needs;
+}
+
+void TimestepLoader::SetNeedsIndex(bool needs) {
+  needsIndex = needs;
+}
+
+void TimestepLoader::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    requestAvailable.wait(lock, [this] { return stopping || hasPending; });
+    if (stopping) {
+      return;
+    }
+
+    double time = pendingTime;
+    auto requestTime = pendingRequestTime;
+    uint64_t requestGeneration = generation;
+    hasPending = false;
+    lock.unlock();
+
+    PreparedTimestep prepared;
+    bool failed = false;
+    try {
+      prepared = Prepare(time, requestGeneration);
+    } catch (const std::exception &e) {
+      printf("[TimestepLoader]: Loading timestep %.2f failed: %s\n", time,
+             e.what());
+      failed = true;
+    }
+
+    lock.lock();
+    int step = prepared.step;
+    bool completed = false;
+    if (prepared.particles && requestGeneration == generation) {
+      prepared.requestTime = requestTime;
+      ready = std::move(prepared);
+      hasReady = true;
+      stats.completed++;
+      completed = true;
+    } else if (!failed) {
+      stats.cancelled++;
+    }
+
+    // Only once the step was handed out, so the index never delays it
+    if (completed && needsIndex) {
+      lock.unlock();
+      try {
+        cache->GetIndex(step);
+      } catch (const std::exception &e) {
+        printf("[TimestepLoader]: Indexing timestep %d failed: %s\n", step,
+               e.what());
+      }
+      lock.lock();
+    }
+  }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+#include "../processing/ParticleAttributesAlgorithm.hxx"
+#include "../processing/ParticleTypeFilter.hxx"
+
+class SnapshotCache;
+class vtkPolyData;
+
+// Returns the cluster table to use for the given step
+typedef std::function<std::shared_ptr<const ClusterTable>(int step)>
+    ClusterTableLookup;
+
+// Everything the render pipeline needs of one timestep
+struct PreparedTimestep {
+  // The snapshot at or before time
+  int step = -1;
+  // Equals step unless the timestep was interpolated between two snapshots
+  double time = -1;
+  // The snapshot with the Temperature and Cluster columns
+  vtkSmartPointer<vtkPolyData> particles;
+  vtkSmartPointer<vtkPolyData> stars;
+  // nullptr unless the loader was asked for them
+  vtkSmartPointer<vtkPolyData> baryons;
+  // The points of particles grouped by their type
+  std::shared_ptr<const ParticleTypeBuckets> typeBuckets;
+
+  // Latency of the stages
+  double loadSeconds = 0;
+  double filterSeconds = 0;
+  std::chrono::steady_clock::time_point requestTime;
+};
+
+struct TimestepLoaderStats {
+  // Number of calls to Request()
+  uint64_t requested = 0;
+  // Requests which were superseded before the worker started them
+  uint64_t dropped = 0;
+  // Requests which were superseded while the worker prepared them
+  uint64_t cancelled = 0;
+  // Prepared timesteps which were superseded before being swapped in
+  uint64_t discarded = 0;
+  uint64_t completed = 0;
+};
+
+/*
+  Loads and filters timesteps on a worker thread (the back buffer). The main
+  thread picks up the finished timestep with TakeReady() and swaps it into
+  the render pipeline, so the interactor never waits for a timestep.
+
+  Only the latest requested step is kept: a new request replaces a pending
+  one and cancels the one in flight at its next stage boundary.
+
+  Times between two snapshots (odd or fractional steps) are interpolated
+  from the snapshots around them before filtering.
+*/
+class TimestepLoader {
+public:
+  TimestepLoader(SnapshotCache *cache, std::vector<int> steps,
+                 ClusterTableLookup clusters);
+  ~TimestepLoader();
+
+  // Loads and filters the time on the calling thread
+  PreparedTimestep Prepare(double time);
+
+  // Schedules the time to be prepared on the worker thread, superseding all
+  // earlier requests
+  void Request(double time);
+
+  // Returns true and moves the most recently prepared step into out if one
+  // finished since the last call.
+  bool TakeReady(PreparedTimestep &out);
+
+  TimestepLoaderStats GetStats();
+
+  // Looks up the cluster table again for the next prepared step, e.g. after
+  // the clusters of a step were computed
+  void InvalidateClusters();
+
+  // Whether the next prepared steps get the "LogTemperature" column
+  void SetComputeLogTemperature(bool compute);
+
+  // Whether the derived columns of the next prepared steps are floats
+  void SetSinglePrecision(bool single);
+
+  // Whether the next prepared steps get the baryon subset, which only SPH
+  // needs
+  void SetNeedsBaryons(bool needs);
+
+  // Whether the spatial index of the prepared snapshots is built (after
+  // they are handed out), for the queries of the main thread
+  void SetNeedsIndex(bool needs);
+
+private:
+  SnapshotCache *cache;
+  // All available snapshots in ascending order
+  std::vector<int> steps;
+  double lastTime = -1;
+
+  // The filter below is only used by one Prepare() at a time
+  std::mutex prepareMutex;
+
+  vtkNew<ParticleAttributesAlgorithm> attributesFilter;
+
+  ClusterTableLookup clusterLookup;
+  // The table of clusterStep, looked up once per step
+  int clusterStep = -1;
+  std::shared_ptr<const ClusterTable> clusterTable;
+  std::atomic<bool> clustersChanged{false};
+  std::atomic<bool> logTemperature{false};
+  std::atomic<bool> singlePrecision{false};
+  std::atomic<bool> needsBaryons{true};
+  std::atomic<bool> needsIndex{false};
+
+  // Incremented by every request, the worker compares it against the
+  // generation it is working on to notice that it was superseded
+  std::atomic<uint64_t> generation{0};
+
+  // Latest request and the finished back buffer
+  std::mutex mutex;
+  std::condition_variable requestAvailable;
+  bool stopping = false;
+  bool hasPending = false;
+  double pendingTime = -1;
+  std::chrono::steady_clock::time_point pendingRequestTime;
+  bool hasReady = false;
+  PreparedTimestep ready;
+  TimestepLoaderStats stats;
+  std::thread worker;
+
+  // Returns a PreparedTimestep without particles if requestGeneration got
+  // superseded
+  PreparedTimestep Prepare(double time, uint64_t requestGeneration);
+  bool IsSuperseded(uint64_t requestGeneration);
+
+  void WorkerLoop();
+};
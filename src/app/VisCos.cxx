@@ -5,6 +5,10 @@
 #include <utility>
 #include <stdint.h>
 #include <algorithm>
+#include <cmath>
+#include <iterator> // for prev
+#include <stdexcept> // for runtime_error
+#include <vector>
 // IWYU pragma: no_include <bits/chrono.h>
 
 #include <vtkCamera.h>
@@ -13,15 +17,11 @@
 #include <vtkCoordinate.h>
 #include <vtkGlyph3D.h>
 #include <vtkPiecewiseFunction.h>
-#include <vtkSmoothPolyDataFilter.h>
-#include <vtkStructuredGrid.h>
+#include <vtkDataArray.h>
 #include <vtkPointData.h>
 #include <vtkPolyData.h>
 #include <vtkProgrammableFilter.h>
 #include <vtkProperty.h>
-#include <vtkImageData.h>
-#include <vtkSPHInterpolator.h>
-#include <vtkSPHQuinticKernel.h>
 #include <vtkSliderRepresentation.h>
 #include <vtkSliderRepresentation2D.h>
 #include <vtkSmartVolumeMapper.h>
@@ -33,15 +33,17 @@
 #include <vtkVolumeCollection.h>
 #include <vtkXMLPolyDataReader.h>
 
+#include "../data/Clustering.hxx"
 #include "../data/Loader.h"
+#include "../data/Manifest.hxx"
+#include "../data/QuantileSketch.hxx"
+#include "../data/SnapshotCache.hxx"
+#include "../data/SpatialIndex.hxx"
 #include "../interactive/KeyPressInteractorStyle.hxx"
 #include "../interactive/TimeSliderCallback.hxx"
-#include "../processing/AssignClusterFilter.hxx"
-#include "../processing/CalculateTemperatureFilter.hxx"
+#include "../processing/ParticleAttributesAlgorithm.hxx"
 #include "../processing/ParticleTypeFilter.hxx"
-#include "../processing/PolyDataToImageDataAlgorithm.hxx"
-#include "../processing/StarFilter.hxx"
-#include "../processing/BaryonFilter.hxx"
+#include "../processing/TemperatureKernel.hxx"
 #include "../helper/helper.hxx"
 #include "../interactive/ResizeWindowCallback.hxx"
 
@@ -50,21 +52,22 @@ namespace fs = std::filesystem;
 VisCos::VisCos(int initial_active_timestep, std::string data_folder_path,
                std::string cluster_path) {
   this->active_timestep = initial_active_timestep;
+  this->active_time = initial_active_timestep;
+  this->requested_time = initial_active_timestep;
   this->data_folder_path = data_folder_path;
   this->cluster_path = cluster_path;
 
   this->timeSliderCallback->app = this;
   this->resizeCallback->app = this;
+  this->timestepSwapCallback->app = this;
+  this->renderCallback->app = this;
+  this->interactionCallback->app = this;
 
   this->keyboardInteractorStyle->app = this;
   this->keyboardInteractorStyle->renderWindow = this->renderWindow;
   this->keyboardInteractorStyle->dataMapper = this->dataMapper;
   this->keyboardInteractorStyle->SetCurrentRenderer(this->renderer);
 
-  // Makes the point appear at their exact location
-  this->singlePointSource->SetRadius(0.0);
-  this->singlePointSource->SetNumberOfPoints(1);
-
   this->sphereSource->SetRadius(0.01);
 
   this->colors->SetColor("DisabledParticleTypeColor", "#A9A9A9");
@@ -77,21 +80,79 @@ VisCos::VisCos(int initial_active_timestep, std::string data_folder_path,
   opacityFunction->ClampingOn();
 }
 
+VisCos::~VisCos() {
+  // The loader and the clustering use the cache, stop them first
+  if (this->clusterWorker.joinable()) {
+    this->clusterWorker.join();
+  }
+  this->timestepLoader.reset();
+  this->snapshotCache.reset();
+}
+
 void VisCos::Load() {
-  std::map<int, fs::path> files =
-      load_cosmology_dataset(data_folder_path);
-  printf("Loaded %lu files.\n", files.size());
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+  fs::path manifestFile = manifest_path(data_folder_path);
+  if (fs::exists(manifestFile)) {
+    // The manifest is optional, without it the snapshots are only decoded
+    // to learn about them
+    Manifest loadedManifest;
+    bool current = false;
+    try {
+      loadedManifest = load_manifest(manifestFile);
+      // Snapshots added or written after the manifest are not described by
+      // it
+      current = manifest_is_current(loadedManifest, data_folder_path);
+    } catch (const std::runtime_error &e) {
+      printf("Unable to read the manifest: %s\n", e.what());
+    }
+    if (current) {
+      this->manifest = std::move(loadedManifest);
+      printf("Loaded the manifest of %lu files.\n", files.size());
+    } else {
+      printf("Loaded %lu files, ignoring the outdated manifest (VisCosTool "
+             "manifest rebuilds it).\n",
+             files.size());
+    }
+  } else {
+    printf("Loaded %lu files (VisCosTool manifest describes them before "
+           "loading).\n",
+           files.size());
+  }
 
   for (auto path : files) {
-    vtkXMLPolyDataReader *reader = vtkXMLPolyDataReader::New();
-    int index = path.first;
-    reader->SetFileName(path.second.c_str());
-
-    this->dataset_readers.insert_or_assign(path.first, reader);
+    this->timesteps.push_back(path.first);
+  }
+  this->snapshotFiles = files;
+
+  this->snapshotCache = std::make_unique<SnapshotCache>(
+      this->timesteps,
+      [files, single = this->singlePrecision](int step,
+                                              const ColumnSet &columns) {
+        return load_snapshot(step, files.at(step), single, columns);
+      },
+      this->cacheBudget, 2);
+  this->snapshotCache->SetPrefetchDistance(this->prefetchDistance);
+  this->snapshotCache->SetColumns(RequiredColumns());
+  printf("Finished creating the snapshot cache (budget %lu MiB).\n",
+         this->cacheBudget / (1024 * 1024));
+  FitPrefetchToBudget();
+
+  // The same colors for phi in all timesteps
+  double phiRange[2];
+  if (series_range(this->manifest, "phi", phiRange)) {
+    this->phiLUT->SetTableRange(phiRange);
+    this->phiLUT->Build();
+  }
+  ApplySketchedRanges();
+
+  // Load cluster assignments (of the last timestep), used for all timesteps
+  // without their own cluster table
+  if (!fs::exists(cluster_path)) {
+    printf("No clusters at %s, only timesteps with a cluster table show "
+           "clusters (compute them with 'k' or VisCosTool cluster).\n",
+           cluster_path.c_str());
+    return;
   }
-  printf("Finished creating %ld data loaders.\n", this->dataset_readers.size());
-
-  // Load cluster assignments
   vtkNew<vtkXMLPolyDataReader> clusterReader;
   clusterReader->SetFileName(cluster_path.c_str());
   clusterReader->Update();
@@ -104,65 +165,466 @@ void VisCos::Load() {
   vtkTypeInt64Array *carr = static_cast<vtkTypeInt64Array *>(
       data->GetPointData()->GetArray("cluster_id"));
 
+  vtkTypeInt64 maxId = num - 1;
   for (vtkIdType i = 0; i < num; i++) {
-    int id = ids->GetValue(i);
-    int cluster = carr->GetValue(i);
+    maxId = std::max(maxId, ids->GetValue(i));
+  }
 
-    // map to positive values as negative values do not work with the 
-    // color lookup table (LUT)
-    if (cluster == -1) {
-      clusters.insert_or_assign(id, 26);
-    } else {
-      clusters.insert_or_assign(id, cluster);
-    }
+  // Marks ids without an assignment until all clusters are read, -1 is
+  // already noise
+  const short unassigned = -2;
+  clusters.assign(maxId + 1, unassigned);
+  for (vtkIdType i = 0; i < num; i++) {
+    vtkTypeInt64 id = ids->GetValue(i);
+    vtkTypeInt64 cluster = carr->GetValue(i);
+    if (id < 0) continue;
+
+    clusters[id] = cluster_color(cluster);
   }
 
   // print point ids which have no cluster assigned
-  for (vtkIdType i = 0; i < num; i++) {
-    if (clusters.find(i) == clusters.end()) {
+  for (vtkIdType i = 0; i < (vtkIdType)clusters.size(); i++) {
+    if (clusters[i] == unassigned) {
       printf("Missing point in cluster ass: %lld\n", i);
+      clusters[i] = NO_CLUSTER;
     }
   }
   printf("Finished reading %lld clusters\n", num);
 }
 
+void VisCos::SetCacheBudget(size_t bytes) {
+  this->cacheBudget = bytes;
+  if (this->snapshotCache) {
+    this->snapshotCache->SetBudget(bytes);
+  }
+}
+
+void VisCos::SetSinglePrecision(bool single) {
+  this->singlePrecision = single;
+}
+
+void VisCos::SetPrefetchDistance(int distance) {
+  this->prefetchDistance = distance;
+  if (this->snapshotCache) {
+    this->snapshotCache->SetPrefetchDistance(distance);
+  }
+}
+
+/*
+  With a manifest the decoded size of every snapshot is known up front. The
+  cache has to hold the snapshot on screen, the prefetched ones and the one
+  behind, otherwise the prefetches evict each other.
+*/
+void VisCos::FitPrefetchToBudget() {
+  size_t largest = 0;
+  for (const auto &entry : this->manifest) {
+    largest = std::max(largest, entry.second.DecodedSize(
+                                    RequiredColumns(), this->singlePrecision));
+  }
+  if (largest == 0) {
+    return;
+  }
+
+  size_t fit = this->cacheBudget / largest;
+  printf("The cache holds %lu snapshots of up to %lu MiB.\n", fit,
+         largest / (1024 * 1024));
+  if (fit < static_cast<size_t>(this->prefetchDistance) + 2) {
+    int distance = std::max(static_cast<int>(fit) - 2, 0);
+    printf("Lowering the prefetch distance from %d to %d.\n",
+           this->prefetchDistance, distance);
+    SetPrefetchDistance(distance);
+  }
+}
+
+/*
+  The sketches (VisCosTool sketch) of all snapshots are merged, so every
+  timestep is colored on the same scale. The ranges span the 1st to 99th
+  percentile, which a handful of extreme particles can not stretch, and the
+  temperature switches to a logarithmic table if it spans several decades.
+*/
+void VisCos::ApplySketchedRanges() {
+  fs::path path = sketches_path(data_folder_path);
+  if (!fs::exists(path)) {
+    printf("No sketches at %s, using the default color ranges (VisCosTool "
+           "sketch computes them).\n",
+           path.c_str());
+    return;
+  }
+  SnapshotSketches merged;
+  try {
+    merged = load_merged_sketches(path);
+  } catch (const std::runtime_error &e) {
+    printf("Unable to read the sketches: %s, using the default color ranges "
+           "(VisCosTool sketch computes them).\n",
+           e.what());
+    return;
+  }
+
+  auto temperature = merged.find("Temperature");
+  if (temperature != merged.end() && temperature->second.GetCount() > 0) {
+    ColorRange color = color_range(temperature->second);
+    this->tempRange[0] = color.range[0];
+    this->tempRange[1] = color.range[1];
+    this->tempLUT->SetTableRange(color.range);
+    if (color.logScale) {
+      this->tempLUT->SetScaleToLog10();
+    } else {
+      this->tempLUT->SetScaleToLinear();
+    }
+    this->tempLUT->Build();
+    printf("Temperature colors %g to %g (%s)\n", color.range[0],
+           color.range[1], color.logScale ? "log" : "linear");
+
+    if (color.range[0] > 0) {
+      this->logTempLUT->SetTableRange(std::log10(color.range[0]),
+                                      std::log10(color.range[1]));
+      this->logTempLUT->Build();
+    }
+  }
+
+  auto phi = merged.find("phi");
+  if (phi != merged.end() && phi->second.GetCount() > 0) {
+    ColorRange color = color_range(phi->second);
+    this->phiLUT->SetTableRange(color.range);
+    this->phiLUT->Build();
+    printf("Phi colors %g to %g\n", color.range[0], color.range[1]);
+  }
+}
+
+void VisCos::UpdateSliderTitle(double time) {
+  // The snapshot at or before the time
+  auto next = this->manifest.upper_bound(static_cast<int>(time));
+  if (next == this->manifest.begin()) {
+    this->timeSliderRepr->SetTitleText("Timestep");
+    return;
+  }
+  const SnapshotSummary &summary = std::prev(next)->second;
+
+  char title[128];
+  snprintf(title, sizeof(title),
+           "Timestep %d (z = %.1f, %.1fM particles, %.1fM baryons)",
+           summary.step, Redshift(summary.step), summary.numPoints / 1e6,
+           summary.numBaryons / 1e6);
+  this->timeSliderRepr->SetTitleText(title);
+}
+
 void VisCos::MoveToTimestep(int step) {
-  if (step % 2 == 1) {
+  if (step % 2 == 1 && !this->interpolating) {
     printf("Tried to move to timestep %d which is invalid. We only have even "
-           "steps (for now).\n",
+           "steps (enable interpolation with 'o').\n",
            step);
     return;
   }
-  if (step == this->active_timestep) return;
+  MoveToTime(step);
+}
 
-  // Set the active reader and get its output to be the polydata
-  activeReader = dataset_readers.at((vtkIdType)step);
+void VisCos::MoveToTime(double time) {
+  if (time == this->requested_time) return;
+
+  UpdateSliderTitle(time);
 
-  activeReader->Update();
   reinterpret_cast<vtkSliderRepresentation *>(
       this->timeSliderWidget->GetRepresentation())
-      ->SetValue((double)step);
+      ->SetValue(time);
   this->timeSliderRepr->Modified();
   this->timeSliderWidget->Modified();
 
-  this->temperatureFilter->SetInputConnection(activeReader->GetOutputPort());
-  this->temperatureFilterParams.data = activeReader->GetOutput();
+  // Loading and filtering happens in the background, the result is swapped
+  // in by SwapInPreparedTimestep(). While the slider animates, every
+  // intermediate step supersedes the previous one, so only the latest one
+  // is actually prepared.
+  this->timestepLoader->Request(time);
+  this->requested_time = time;
+}
+
+void VisCos::SwapInPreparedTimestep() {
+  if (this->playing) {
+    PlaybackTick();
+    return;
+  }
+
+  PreparedTimestep prepared;
+  if (!this->timestepLoader->TakeReady(prepared)) {
+    return;
+  }
+  ShowPreparedTimestep(prepared);
+
+  TimestepLoaderStats stats = this->timestepLoader->GetStats();
+  printf("Switching to timestep: %.2f (requests: %lu, dropped: %lu, "
+         "cancelled: %lu, discarded: %lu)\n",
+         prepared.time, stats.requested, stats.dropped, stats.cancelled,
+         stats.discarded);
+}
+
+void VisCos::ShowPreparedTimestep(PreparedTimestep &prepared) {
+  this->activeData = prepared;
+
+  this->particleTypeFilter->SetInputData(activeData.particles);
+  this->particleFilterParams.data = activeData.particles;
+  this->particleFilterParams.buckets = activeData.typeBuckets.get();
+
+  this->starGlyph3D->SetInputData(activeData.stars);
 
-  // Update the filter which comes next
-  this->temperatureFilter->Update();
+  if (activeData.baryons != nullptr) {
+    RequestSPH();
+  } else if (IsSPHOn() && this->requested_time == prepared.time) {
+    // Prepared before SPH was enabled
+    this->timestepLoader->Request(prepared.time);
+  }
 
-  printf("Switching to timestep: %d\n", step);
+  reinterpret_cast<vtkSliderRepresentation *>(
+      this->timeSliderWidget->GetRepresentation())
+      ->SetValue(prepared.time);
   this->camera->Modified();
 
   this->renderWindow->Render();
-  this->active_timestep = step;
+  this->active_timestep = prepared.step;
+  this->active_time = prepared.time;
+}
+
+bool VisCos::IsPlaying() {
+  return this->playing;
+}
+
+void VisCos::StartPlayback() {
+  if (this->playing || this->timesteps.empty()) return;
+
+  this->playing = true;
+  this->playbackStats = PlaybackStats();
+  this->nextFrameTime = std::chrono::steady_clock::now();
+  this->heldSlots = 0;
+  this->lastPlaybackReport = this->nextFrameTime;
+
+  // Start preparing the frame after the one on screen
+  this->requested_time = NextPlaybackTime(this->active_time, 1);
+  this->timestepLoader->Request(this->requested_time);
+
+  printf("Playing at %.1f fps\n", this->playbackFps);
+}
+
+void VisCos::StopPlayback() {
+  if (!this->playing) return;
+
+  this->playing = false;
+  ReportPlayback();
+  printf("Paused playback at timestep %.2f\n", this->active_time);
+}
+
+void VisCos::TogglePlayback() {
+  if (this->playing) {
+    StopPlayback();
+  } else {
+    StartPlayback();
+  }
+}
+
+void VisCos::SetPlaybackFps(double fps) {
+  this->playbackFps = std::max(fps, 0.5);
+  printf("Playback at %.1f fps\n", this->playbackFps);
+}
+
+double VisCos::GetPlaybackFps() {
+  return this->playbackFps;
+}
+
+/*
+  Called by the swap timer while playing. The timestep on screen (N) stays
+  until its slot is over, meanwhile the loader filters N+1 and the snapshot
+  cache decodes N+1 and N+2. If N+1 is not ready in time, N is held and the
+  timesteps whose slots passed in the meantime are dropped, so the playback
+  keeps its pace instead of stalling.
+*/
+void VisCos::PlaybackTick() {
+  auto now = std::chrono::steady_clock::now();
+  if (now < this->nextFrameTime) return;
+
+  std::chrono::duration<double> interval(1.0 / this->playbackFps);
+  int late = static_cast<int>((now - this->nextFrameTime) / interval);
+
+  PreparedTimestep prepared;
+  if (!this->timestepLoader->TakeReady(prepared)) {
+    // Every slot which passes without the next frame is held once, although
+    // the timer checks several times per slot
+    if (late + 1 > this->heldSlots) {
+      playbackStats.held += late + 1 - this->heldSlots;
+      this->heldSlots = late + 1;
+    }
+    return;
+  }
+  this->heldSlots = 0;
+
+  auto renderStart = std::chrono::steady_clock::now();
+  ShowPreparedTimestep(prepared);
+  auto renderEnd = std::chrono::steady_clock::now();
+
+  playbackStats.shown++;
+  playbackStats.dropped += late;
+  playbackStats.loadSeconds += prepared.loadSeconds;
+  playbackStats.filterSeconds += prepared.filterSeconds;
+  playbackStats.latencySeconds +=
+      std::chrono::duration<double>(renderStart - prepared.requestTime).count();
+  playbackStats.renderSeconds +=
+      std::chrono::duration<double>(renderEnd - renderStart).count();
+
+  this->nextFrameTime +=
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          interval * (late + 1));
+
+  // Pipeline the next frame right away
+  this->requested_time = NextPlaybackTime(prepared.time, 1 + late);
+  this->timestepLoader->Request(this->requested_time);
+
+  if (renderEnd - this->lastPlaybackReport > std::chrono::seconds(2)) {
+    ReportPlayback();
+  }
+}
+
+bool VisCos::IsInterpolating() {
+  return this->interpolating;
+}
+
+void VisCos::ToggleInterpolation() {
+  this->interpolating = !this->interpolating;
+  printf("%s interpolation between timesteps\n",
+         this->interpolating ? "Enabled" : "Disabled");
+  // The velocities are loaded (for the next steps) once interpolating
+  UpdateColumns();
+
+  if (!this->interpolating && this->active_time != this->active_timestep) {
+    MoveToTime(this->active_timestep);
+  }
+}
+
+/*
+  Cluster table of the step, computed by VisCosTool cluster or
+  ClusterActiveTimestep(). Falls back to the clusters of clusters.vtp.
+*/
+std::shared_ptr<const ClusterTable> VisCos::LoadClusterTable(int step) {
+  auto file = this->snapshotFiles.find(step);
+  if (file != this->snapshotFiles.end()) {
+    fs::path path = cluster_table_path(file->second);
+    if (fs::exists(path)) {
+      try {
+        std::vector<int32_t> labels = load_cluster_table(path);
+        auto table = std::make_shared<ClusterTable>(labels.size());
+        for (size_t id = 0; id < labels.size(); id++) {
+          (*table)[id] = cluster_color(labels[id]);
+        }
+        return table;
+      } catch (const std::runtime_error &e) {
+        printf("Unable to read the clusters: %s (VisCosTool cluster "
+               "computes them again).\n",
+               e.what());
+      }
+    }
+  }
+  // Not owned, the clusters outlive the loader
+  return std::shared_ptr<const ClusterTable>(
+      std::shared_ptr<const ClusterTable>(), &this->clusters);
+}
+
+/*
+  Runs on a thread of its own, clustering a snapshot takes seconds. The
+  timestep is prepared again with the new table by SwapInClusters().
+*/
+void VisCos::ClusterActiveTimestep() {
+  auto file = this->snapshotFiles.find(this->active_timestep);
+  if (file == this->snapshotFiles.end()) return;
+
+  if (this->clustering) {
+    printf("Still clustering, try again once it finished\n");
+    return;
+  }
+  if (this->clusterWorker.joinable()) {
+    this->clusterWorker.join();
+  }
+
+  int step = this->active_timestep;
+  fs::path table = cluster_table_path(file->second);
+  printf("Clustering timestep %d...\n", step);
+
+  this->clustering = true;
+  this->clusterWorker = std::thread([this, step, table]() {
+    auto start = std::chrono::steady_clock::now();
+    try {
+      vtkSmartPointer<vtkPolyData> snapshot = this->snapshotCache->Get(step);
+      std::vector<int> labels =
+          find_clusters(snapshot, ClusteringParams(),
+                        this->snapshotCache->GetIndex(step).get());
+      write_cluster_table(snapshot, labels, table);
+
+      printf("Clustered timestep %d in %.1f s\n", step,
+             std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           start)
+                 .count());
+      this->clustersWritten = true;
+    } catch (const std::exception &e) {
+      printf("Clustering timestep %d failed: %s\n", step, e.what());
+    }
+    this->clustering = false;
+  });
+}
+
+void VisCos::SwapInClusters() {
+  if (!this->clustersWritten.exchange(false)) {
+    return;
+  }
+  // Prepare the timestep on screen again with its new clusters
+  this->timestepLoader->InvalidateClusters();
+  this->timestepLoader->Request(this->active_time);
+  this->requested_time = this->active_time;
+}
+
+/*
+  Time of the frame which is the given number of frames after time. Without
+  interpolation the frames are the snapshots, with interpolation the
+  playback also shows the (odd) steps in between.
+*/
+double VisCos::NextPlaybackTime(double time, int frames) {
+  if (!this->interpolating) {
+    auto current = std::lower_bound(timesteps.begin(), timesteps.end(),
+                                    static_cast<int>(time));
+    long index = (current - timesteps.begin() + frames) % timesteps.size();
+    return timesteps[index];
+  }
+
+  double first = timesteps.front();
+  double last = timesteps.back();
+  double next = std::floor(time) + frames;
+  if (next > last) {
+    next = first + std::fmod(next - first, last - first + 1);
+  }
+  return next;
+}
+
+void VisCos::ReportPlayback() {
+  auto now = std::chrono::steady_clock::now();
+  double elapsed =
+      std::chrono::duration<double>(now - this->lastPlaybackReport).count();
+  int shown = std::max(playbackStats.shown, 1);
+
+  printf("[Playback]: %.1f fps (target %.1f), held %d, dropped %d, "
+         "load %.1f ms, filter %.1f ms, latency %.1f ms, render %.1f ms\n",
+         playbackStats.shown / elapsed, this->playbackFps, playbackStats.held,
+         playbackStats.dropped, 1000 * playbackStats.loadSeconds / shown,
+         1000 * playbackStats.filterSeconds / shown,
+         1000 * playbackStats.latencySeconds / shown,
+         1000 * playbackStats.renderSeconds / shown);
+
+  this->playbackStats = PlaybackStats();
+  this->lastPlaybackReport = now;
 }
 
 void VisCos::ShowClusters() {
+  this->phiShown = false;
+  UpdateColumns();
+  // Timesteps prepared from now on no longer need the log temperature
+  this->timestepLoader->SetComputeLogTemperature(false);
+
   this->dataMapper->ScalarVisibilityOn();
   this->dataMapper->SelectColorArray("Cluster");
 
-  this->dataMapper->SetScalarRange(0, 26);
+  this->dataMapper->SetScalarRange(0, NUM_CLUSTER_COLORS - 1);
   this->dataMapper->SetLookupTable(this->clusterLUT);
   this->dataMapper->InterpolateScalarsBeforeMappingOff();
 
@@ -175,16 +637,19 @@ void VisCos::ShowClusters() {
 
   this->camera->Modified();
 
-  this->dataMapper->Update();
   this->scalarBarWidget->Off();
   this->renderWindow->Render();
 }
 
 void VisCos::ShowTemperature() {
+  this->phiShown = false;
+  UpdateColumns();
+  this->timestepLoader->SetComputeLogTemperature(false);
+
   this->dataMapper->SelectColorArray("Temperature");
   this->dataMapper->InterpolateScalarsBeforeMappingOn();
   this->dataMapper->SetLookupTable(this->tempLUT);
-  this->dataMapper->SetScalarRange(0, 7000);
+  this->dataMapper->SetScalarRange(this->tempRange);
   this->dataMapper->Modified();
 
   this->manyParticlesActor->GetProperty()->SetAmbient(2.3);
@@ -199,19 +664,61 @@ void VisCos::ShowTemperature() {
   this->scalarBarWidget->On();
   this->camera->Modified();
 
-  this->temperatureFilterParams.filter->Update();
-  this->dataMapper->Update();
+  this->scalarBarWidget->Render();
+  this->renderWindow->Render();
+}
+
+/*
+  Colors the particles by log10 of the temperature, which resolves the cold
+  gas as well as the hot halos. The column is only computed once this view
+  was chosen, so the timestep on screen is prepared again if it lacks it.
+*/
+void VisCos::ShowLogTemperature() {
+  this->phiShown = false;
+  UpdateColumns();
+  this->timestepLoader->SetComputeLogTemperature(true);
+  if (this->activeData.particles->GetPointData()->GetArray("LogTemperature") ==
+      nullptr) {
+    this->timestepLoader->Request(this->active_time);
+    this->requested_time = this->active_time;
+  }
+
+  this->dataMapper->SelectColorArray("LogTemperature");
+  this->dataMapper->InterpolateScalarsBeforeMappingOn();
+  this->dataMapper->SetLookupTable(this->logTempLUT);
+  this->dataMapper->SetScalarRange(this->logTempLUT->GetRange());
+  this->dataMapper->Modified();
+
+  this->manyParticlesActor->GetProperty()->SetAmbient(2.3);
+  this->manyParticlesActor->GetProperty()->SetPointSize(2.0);
+  this->manyParticlesActor->GetProperty()->SetOpacity(0.3);
+  this->manyParticlesActor->Modified();
+
+  this->scalarBarActor->SetTitle("log10(Temperature)");
+  this->scalarBarActor->SetLookupTable(this->logTempLUT);
+  this->scalarBarActor->Modified();
+  this->scalarBarWidget->Modified();
+  this->scalarBarWidget->On();
+  this->camera->Modified();
+
   this->scalarBarWidget->Render();
   this->renderWindow->Render();
 }
 
 void VisCos::ShowPhi() {
+  this->phiShown = true;
+  this->timestepLoader->SetComputeLogTemperature(false);
+  // Shown once the timestep was prepared again with the column
+  if (UpdateColumns()) {
+    this->timestepLoader->Request(this->active_time);
+    this->requested_time = this->active_time;
+  }
+
   this->dataMapper->SelectColorArray("phi");
   this->dataMapper->InterpolateScalarsBeforeMappingOn();
   this->dataMapper->SetScalarRange(this->phiLUT->GetRange());
   this->dataMapper->SetLookupTable(this->phiLUT);
   this->dataMapper->Modified();
-  this->dataMapper->Update();
 
   this->manyParticlesActor->GetProperty()->SetAmbient(1.0);
   this->manyParticlesActor->GetProperty()->SetPointSize(1.5);
@@ -229,6 +736,41 @@ void VisCos::ShowPhi() {
   this->renderWindow->Render();
 }
 
+/*
+  The particle attributes always need uu, id and mask. Everything else
+  (velocities, SPH quantities, phi) is only read from the snapshots while a
+  view uses it, the cache fetches it lazily for snapshots loaded without.
+*/
+ColumnSet VisCos::RequiredColumns() {
+  ColumnSet columns{"uu", "id", "mask"};
+  if (this->phiShown) {
+    columns.insert("phi");
+  }
+  if (this->sphEnabled) {
+    columns.insert({"mass", "rho", "hh"});
+  }
+  if (this->interpolating) {
+    columns.insert({"vx", "vy", "vz"});
+  }
+  return columns;
+}
+
+bool VisCos::UpdateColumns() {
+  ColumnSet columns = RequiredColumns();
+  this->snapshotCache->SetColumns(columns);
+
+  if (this->activeData.particles == nullptr) {
+    return false;
+  }
+  vtkPointData *pointData = this->activeData.particles->GetPointData();
+  for (const std::string &column : columns) {
+    if (pointData->GetArray(column.c_str()) == nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void VisCos::SetBackgroundColor(std::string color) {
   this->colors->SetColor("BkgColor", color);
 
@@ -237,94 +779,70 @@ void VisCos::SetBackgroundColor(std::string color) {
 
 /*
   Current pipeline:
-    * dataset_readers
-    * activeReader      [chosen timestep]
-    * temperatureFilter
-    * clusterFilter
+    * snapshotCache
+    * timestepLoader    [worker thread]
+      * attributesFilter [temperature, clusters, stars, baryons, type buckets]
+    * activeData        [prepared timestep, swapped in on a timer]
     * particleTypeFilter
-    * glyph3D
+    * particleLOD       [octree, at most pointBudget points for the camera]
+    * particleVertices  [vertex cells, shares the points and arrays]
     * 
+
+  Nothing is updated here. The render pulls the branches of the visible
+  actors and volumes only, so e.g. the SPH branch executes for the first
+  time when SPH is enabled. Switching the colors only changes the mappers
+  and executes no filter.
 */
 void VisCos::SetupPipeline() {
-  // First we set up the data pipeline
-  vtkXMLPolyDataReader *activeReader;
-  activeReader = this->dataset_readers.at(this->active_timestep);
-
-  // This filter calculates the temperature
-  temperatureFilter->SetInputConnection(activeReader->GetOutputPort());
-  this->temperatureFilterParams.data = activeReader->GetOutput();
-
-  this->temperatureFilterParams.filter = temperatureFilter;
-  this->temperatureFilterParams.mapper = dataMapper;
-  this->temperatureFilterParams.updateScalarRange = false;
-
-  temperatureFilter->SetExecuteMethod(CalculateTemperature,
-                                      &temperatureFilterParams);
-  temperatureFilter->Update();
-
-  // This filter adds a column with the cluster index
-  clusterFilter->SetInputData(temperatureFilter->GetOutput());
-
-  clusterFilterParams.data = static_cast<vtkPolyData *>(temperatureFilter->GetOutput());
-  clusterFilterParams.filter = clusterFilter;
-  clusterFilterParams.clustering = &clusters;
-
-  clusterFilter->SetExecuteMethod(AssignCluster, &clusterFilterParams);
-  clusterFilter->Update();
+  // First we set up the data pipeline. The initial timestep is prepared
+  // right away, all further ones in the background.
+  this->timestepLoader = std::make_unique<TimestepLoader>(
+      this->snapshotCache.get(), this->timesteps,
+      [this](int step) { return LoadClusterTable(step); });
+  this->timestepLoader->SetSinglePrecision(this->singlePrecision);
+  // The baryons only feed SPH, which starts disabled
+  this->timestepLoader->SetNeedsBaryons(false);
+  activeData = this->timestepLoader->Prepare(this->active_time);
 
   // Filters on the different types of particles
-  particleTypeFilter->SetInputConnection(clusterFilter->GetOutputPort());
+  particleTypeFilter->SetInputData(activeData.particles);
 
-  particleFilterParams.data = static_cast<vtkPolyData *>(clusterFilter->GetOutput());
+  particleFilterParams.data = activeData.particles;
+  particleFilterParams.buckets = activeData.typeBuckets.get();
   particleFilterParams.filter = particleTypeFilter;
   particleFilterParams.current_filter = static_cast<uint16_t>(Selector::ALL);
 
   particleTypeFilter->SetExecuteMethod(FilterType, &particleFilterParams);
-  particleTypeFilter->Update();
 
-  // Filter for stars
-  starFilterParams.data = static_cast<vtkPolyData *>(clusterFilter->GetOutput());
-  starFilterParams.filter = starFilter;
+  // Level of detail of the visible particles, at most pointBudget of them
+  // are drawn
+  particleLOD->SetInputConnection(particleTypeFilter->GetOutputPort());
+  particleLOD->SetRenderer(renderer);
+  particleLOD->SetPointBudget(pointBudget);
 
-  starFilter->SetInputConnection(clusterFilter->GetOutputPort());
-  starFilter->SetExecuteMethod(StarType, &starFilterParams);
-  starFilter->Update();
-
-  // Filter for baryons
-  baryonFilterParams.data = static_cast<vtkPolyData *>(clusterFilter->GetOutput());
-  baryonFilterParams.filter = baryonFilter;
-
-  baryonFilter->SetInputConnection(clusterFilter->GetOutputPort());
-  baryonFilter->SetExecuteMethod(BaryonFilter, &baryonFilterParams);
-  baryonFilter->Update();
-
-  // Glyph for many particles
-  glyph3D->SetSourceConnection(singlePointSource->GetOutputPort());
-  glyph3D->SetInputConnection(particleTypeFilter->GetOutputPort());
-  glyph3D->Update();
+  // Vertices for many particles, they share the points and arrays of the
+  // filtered snapshot
+  particleVertices->SetInputConnection(particleLOD->GetOutputPort());
 
   // Glyph for stars
   starGlyph3D->SetSourceConnection(sphereSource->GetOutputPort());
-  starGlyph3D->SetInputConnection(starFilter->GetOutputPort());
-  starGlyph3D->Update();
+  starGlyph3D->SetInputData(activeData.stars);
 
-  // Glyph for marked stuff (dev mode)
+  // Marked stuff (dev mode)
   markedData->SetPoints(markedPoints);
   markedPoints->InsertNextPoint(19.75, 42.56, 36.71);
 
-  markedGlyph3D->SetSourceConnection(singlePointSource->GetOutputPort());
-  markedGlyph3D->SetInputData(markedData);
-  markedGlyph3D->Update();
+  markedVertices->SetInputData(markedData);
 
   // Data Mapper for many particles
-  dataMapper->SetInputConnection(glyph3D->GetOutputPort());
+  dataMapper->SetInputConnection(particleVertices->GetOutputPort());
   dataMapper->SetScalarModeToUsePointFieldData();
 
   // Data Mapper for stars
   starDataMapper->SetInputConnection(starGlyph3D->GetOutputPort());
 
   // Data Mapper for marked particles
-  markedDataMapper->SetInputConnection(markedGlyph3D->GetOutputPort());
+  markedDataMapper->SetInputConnection(markedVertices->GetOutputPort());
   markedDataMapper->SetResolveCoincidentTopology(0);
   markedParticlesActor->SetMapper(markedDataMapper);
   markedParticlesActor->GetProperty()->SetPointSize(20.0);
@@ -336,67 +854,23 @@ void VisCos::SetupPipeline() {
   starParticlesActor->SetMapper(starDataMapper);
   starParticlesActor->GetProperty()->SetColor(255, 255, 0); // (255,255,0) is yellow
 
-  // Set up data mapper for interesting particles
-  vtkPolyData* baryonFilterOutput = static_cast<vtkPolyData*> (baryonFilter->GetOutput());
-  kernel->SetSpatialStep(0.04);
-  kernel->SetDimension(3);
-  kernel->SetMassArray(baryonFilterOutput->GetPointData()->GetArray("mass"));
-  kernel->SetDensityArray(baryonFilterOutput->GetPointData()->GetArray("rho"));
-
-  double spacing[3];
-  spacing[0] = sphVolumeLengths[0] / dimensions[0];
-  spacing[1] = sphVolumeLengths[1] / dimensions[1];
-  spacing[2] = sphVolumeLengths[2] / dimensions[2];
-
-  source = GetSPHStructuredGrid(dimensions, spacing, sphOrigin);
-
-  // Onto what we interpolate
-  interpolator->SetInputData(source);
-
-  // Actual input to interpolate
-  // interpolator->SetSourceData(baryonFilter->GetOutput());
-  interpolator->SetSourceConnection(baryonFilter->GetOutputPort());
-  interpolator->AddExcludedArray("vx");
-  interpolator->AddExcludedArray("vz");
-  interpolator->AddExcludedArray("vy");
-  interpolator->AddExcludedArray("id");
-
-  interpolator->SetMassArrayName("mass");
-  interpolator->SetDensityArrayName("rho");
-  interpolator->SetKernel(kernel);
-  interpolator->Update();
-
-  vtkNew<vtkGlyph3D> sphGlyph;
-  sphGlyph->SetSourceConnection(singlePointSource->GetOutputPort());
-  sphGlyph->SetInputConnection(interpolator->GetOutputPort());
-  sphGlyph->Update();
-
-  vtkNew<vtkSmoothPolyDataFilter> smoothFilter;
-  smoothFilter->SetInputConnection(sphGlyph->GetOutputPort());
-  smoothFilter->SetNumberOfIterations(50);
-  smoothFilter->SetConvergence(0.4);
-  smoothFilter->SetRelaxationFactor(0.1);
-  smoothFilter->FeatureEdgeSmoothingOff();
-  smoothFilter->BoundarySmoothingOn();
-  smoothFilter->Update();
-
-  // Convert the vtkPolyData to vtkImageData
-  // the vtkImageData has its origin at the same point as the structued points have their origin
-  polyDataToImageDataAlgorithm->SetInputConnection(smoothFilter->GetOutputPort());
-  std::copy(dimensions, dimensions + 3, polyDataToImageDataAlgorithm->dimensions);
-  std::copy(sphOrigin, sphOrigin + 3, polyDataToImageDataAlgorithm->sphOrigin);
-  std::copy(sphVolumeLengths, sphVolumeLengths + 3, polyDataToImageDataAlgorithm->volumeLengths);
-  polyDataToImageDataAlgorithm->Update();
+  // SPH density of the baryons in the box around sphOrigin, the levels are
+  // swapped into volumeMapper by SwapInSPHVolume()
+  this->sphRefiner = std::make_unique<SPHRefiner>(
+      std::vector<int>{std::max(sphResolution / 4, 2),
+                       std::max(sphResolution / 2, 2), sphResolution},
+      sphVolumeLengths);
 
   volumeProperty->SetColor(GetSPHLUT());
   volumeProperty->SetScalarOpacity(opacityFunction);
   volumeProperty->SetInterpolationTypeToLinear();
 
-  volumeMapper->SetInputConnection(polyDataToImageDataAlgorithm->GetOutputPort());
   volumeMapper->SetInterpolationModeToCubic();
   // volumeMapper->ComputeNormalFromOpacityOff();
   volumeMapper->InteractiveAdjustSampleDistancesOff();
   volumeMapper->AutoAdjustSampleDistancesOff();
+  // The governor coarsens it while the camera moves
+  sphSampleDistance = volumeMapper->GetSampleDistance();
 
   volume->SetMapper(volumeMapper);
   volume->SetProperty(volumeProperty);
@@ -458,18 +932,81 @@ void VisCos::SetupPipeline() {
 
 void VisCos::UpdateFP() {
   markedPoints->SetPoint(0, camera->GetFocalPoint());
+  // The vertices share the points, so the change is uploaded with them
+  markedPoints->Modified();
   markedDataMapper->Modified();
   markedParticlesActor->Modified();
-  markedGlyph3D->Modified();
-  markedGlyph3D->Update();
+  markedVertices->Modified();
+
+  // Only the newly exposed slabs of the box are splatted
+  if (this->sphFollowing && IsSPHOn()) {
+    SetSPHCenter(camera->GetFocalPoint());
+    RequestSPH();
+  }
 }
 
 void VisCos::AddMarkedPoint(double pos[3]) {
   markedPoints->InsertNextPoint(pos);
+  markedPoints->Modified();
   markedDataMapper->Modified();
   markedParticlesActor->Modified();
-  markedGlyph3D->Modified();
-  markedGlyph3D->Update();
+  markedVertices->Modified();
+}
+
+/*
+  The queries run on the UI thread, so they never build the index: the first
+  one has the loader build it for every prepared snapshot from then on.
+*/
+std::shared_ptr<const SpatialIndex> VisCos::ActiveIndex() {
+  if (this->active_time != this->active_timestep) {
+    printf("Time %.2f is interpolated, the spatial index only covers the "
+           "snapshots\n",
+           this->active_time);
+    return nullptr;
+  }
+
+  auto index = this->snapshotCache->FindIndex(this->active_timestep);
+  if (index == nullptr) {
+    this->timestepLoader->SetNeedsIndex(true);
+    // A pending request builds it anyway
+    if (this->requested_time == this->active_time) {
+      this->timestepLoader->Request(this->active_time);
+    }
+    printf("Building the spatial index of timestep %d, try again in a "
+           "moment\n",
+           this->active_timestep);
+  }
+  return index;
+}
+
+void VisCos::PickParticle(const double pos[3], double maxRadius) {
+  auto index = ActiveIndex();
+  if (index == nullptr) return;
+
+  vtkIdType picked = index->FindClosestPoint(pos, maxRadius);
+  if (picked < 0) {
+    printf("No particle within %.2f Mpc/h of %f %f %f\n", maxRadius, pos[0],
+           pos[1], pos[2]);
+    return;
+  }
+
+  // Same points as the snapshot the index was built on
+  vtkPolyData *snapshot = this->activeData.particles;
+  double p[3];
+  snapshot->GetPoint(picked, p);
+  printf("Picked particle %lld at %f %f %f (%lu particles within %.2f "
+         "Mpc/h)\n",
+         static_cast<long long>(picked), p[0], p[1], p[2],
+         index->FindPointsInSphere(pos, maxRadius).size(), maxRadius);
+  vtkPointData *pointData = snapshot->GetPointData();
+  for (int a = 0; a < pointData->GetNumberOfArrays(); a++) {
+    vtkDataArray *array = pointData->GetArray(a);
+    if (array != nullptr && array->GetNumberOfComponents() == 1) {
+      printf("  %s: %g\n", array->GetName(), array->GetTuple1(picked));
+    }
+  }
+
+  AddMarkedPoint(p);
 }
 
 double *VisCos::GetSPHOrientation() {
@@ -477,41 +1014,148 @@ double *VisCos::GetSPHOrientation() {
 }
 
 bool VisCos::IsSPHOn() {
-  return this->renderer->GetVolumes()->GetNumberOfItems() > 0;
+  return this->sphEnabled;
 }
 
 void VisCos::EnableSPH() {
-  this->renderer->AddVolume(volume);
+  // The baryons are only gathered (and their columns loaded) while SPH is on
+  this->sphEnabled = true;
+  UpdateColumns();
+  this->timestepLoader->SetNeedsBaryons(true);
+
+  // The volume is added once its first level is ready. Without baryons the
+  // timestep on screen is prepared again in the background and
+  // ShowPreparedTimestep() starts the splat once they arrive.
+  if (this->activeData.baryons == nullptr) {
+    this->timestepLoader->Request(this->active_time);
+    this->requested_time = this->active_time;
+  } else {
+    RequestSPH();
+  }
 
   this->sphParticlesActor->SetVisibility(1);
-  this->renderer->Modified();
-  this->renderWindow->Render();
 }
 
 void VisCos::DisableSPH() {
+  this->sphEnabled = false;
+  UpdateColumns();
+  this->timestepLoader->SetNeedsBaryons(false);
   this->renderer->RemoveVolume(volume);
   this->renderer->Modified();
   this->renderWindow->Render();
 }
 
 void VisCos::UpdateSPH() {
-  double spacing[3];
-  spacing[0] = sphVolumeLengths[0] / dimensions[0];
-  spacing[1] = sphVolumeLengths[1] / dimensions[1];
-  spacing[2] = sphVolumeLengths[2] / dimensions[2];
+  RequestSPH();
+}
 
-  source = GetSPHStructuredGrid(dimensions, spacing, sphOrigin);
-  polyDataToImageDataAlgorithm->sphOrigin[0] = sphOrigin[0];
-  polyDataToImageDataAlgorithm->sphOrigin[1] = sphOrigin[1];
-  polyDataToImageDataAlgorithm->sphOrigin[2] = sphOrigin[2];
+// Splats the box of the timestep on screen, coarse levels first
+void VisCos::RequestSPH() {
+  if (!this->sphEnabled || this->activeData.baryons == nullptr) {
+    return;
+  }
+  this->sphRefiner->Request(this->activeData.baryons, this->sphOrigin);
+}
 
-  polyDataToImageDataAlgorithm->Modified();
+void VisCos::SwapInSPHVolume() {
+  SPHVolume level;
+  if (!this->sphEnabled || !this->sphRefiner->TakeReady(level)) {
+    return;
+  }
 
-  interpolator->SetInputData(source);
+  this->volumeMapper->SetInputData(level.image);
+  if (!this->renderer->HasViewProp(this->volume)) {
+    this->renderer->AddVolume(this->volume);
+  }
+  this->renderer->Modified();
+  this->renderWindow->Render();
+
+  if (level.final) {
+    printf("SPH volume refined to %d^3 voxels\n", level.resolution);
+  }
+}
 
-  interpolator->Update();
-  renderer->Modified();
-  renderer->Render();
+void VisCos::SetPointBudget(vtkIdType budget) {
+  this->pointBudget = budget;
+  this->particleLOD->SetPointBudget(budget);
+}
+
+void VisCos::SetTargetFps(double fps) {
+  this->governor.SetTargetFps(fps);
+}
+
+void VisCos::ApplyQuality() {
+  double quality = this->governor.GetQuality();
+
+  this->particleLOD->SetPointBudget(std::max<vtkIdType>(
+      static_cast<vtkIdType>(this->pointBudget * quality), 10000));
+
+  // Fewer samples along the rays, at most one per two voxels
+  double spacing = this->sphVolumeLengths[0] / this->sphResolution;
+  float distance = this->sphSampleDistance;
+  if (quality < 1) {
+    double full = this->sphSampleDistance > 0 ? this->sphSampleDistance
+                                              : 0.5 * spacing;
+    distance = static_cast<float>(std::min(full / quality, 2 * spacing));
+  }
+  this->volumeMapper->SetSampleDistance(distance);
+}
+
+void VisCos::BeforeRender() {
+  this->renderStart = std::chrono::steady_clock::now();
+  this->particleLOD->UpdateSelection();
+}
+
+void VisCos::AfterRender() {
+  this->governor.RecordFrame(std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() -
+                                 this->renderStart)
+                                 .count());
+  // For the next frame
+  if (this->governor.IsInteracting()) {
+    ApplyQuality();
+  }
+}
+
+void VisCos::RequestRender() {
+  this->governor.NoteInteraction();
+  ApplyQuality();
+  this->renderPending = true;
+}
+
+void VisCos::RenderPendingFrame() {
+  // Full quality again once the camera rests
+  if (this->governor.Update()) {
+    ApplyQuality();
+    this->renderPending = true;
+  }
+  if (this->renderPending) {
+    this->renderPending = false;
+    this->renderWindow->Render();
+  }
+}
+
+void VisCos::BeginInteraction() {
+  this->governor.BeginInteraction();
+  ApplyQuality();
+}
+
+void VisCos::EndInteraction() {
+  this->governor.EndInteraction();
+}
+
+void VisCos::SetSPHResolution(int resolution) {
+  this->sphResolution = resolution;
+}
+
+void VisCos::ToggleSPHFollow() {
+  this->sphFollowing = !this->sphFollowing;
+  printf("SPH box %s the focal point\n",
+         this->sphFollowing ? "follows" : "stopped following");
+  if (this->sphFollowing) {
+    UpdateFP();
+    this->renderWindow->Render();
+  }
 }
 
 void VisCos::moreSteps() {
@@ -733,10 +1377,11 @@ void VisCos::UpdateGUIElements() {
 }
 
 void VisCos::Run() {
-  timeSliderRepr->SetMinimumValue(0.0);
-  timeSliderRepr->SetMaximumValue(625);
+  timeSliderRepr->SetMinimumValue(this->timesteps.front());
+  timeSliderRepr->SetMaximumValue(this->timesteps.back());
   timeSliderRepr->SetValue((double)this->active_timestep);
   timeSliderRepr->SetTitleText("Timestep");
+  UpdateSliderTitle(this->active_timestep);
   timeSliderRepr->GetPoint1Coordinate()->SetCoordinateSystemToNormalizedDisplay();
   timeSliderRepr->GetPoint1Coordinate()->SetValue(0.05, 0.10);
   timeSliderRepr->GetPoint2Coordinate()->SetCoordinateSystemToNormalizedDisplay();
@@ -821,9 +1466,26 @@ void VisCos::Run() {
   // Register callback
   timeSliderWidget->AddObserver(vtkCommand::InteractionEvent, timeSliderCallback);
 
+  // Select the level of detail for the camera before every frame and
+  // measure how long the frames take
+  renderer->AddObserver(vtkCommand::StartEvent, renderCallback);
+  renderer->AddObserver(vtkCommand::EndEvent, renderCallback);
+
+  // Lower the quality while the trackball moves the camera
+  keyboardInteractorStyle->AddObserver(vtkCommand::StartInteractionEvent,
+                                       interactionCallback);
+  keyboardInteractorStyle->AddObserver(vtkCommand::EndInteractionEvent,
+                                       interactionCallback);
+
   // Update the GUI when the window is resized
   renderWindow->AddObserver(vtkCommand::WindowResizeEvent, resizeCallback);
 
+  // Poll for timesteps prepared in the background (~60 times a second)
+  renderWindowInteractor->AddObserver(vtkCommand::TimerEvent,
+                                      timestepSwapCallback, 1.0);
+  timestepSwapCallback->timerId =
+      renderWindowInteractor->CreateRepeatingTimer(16);
+
   this->UpdateVisbleParticlesText();
 
   // This starts the event loop and as a side effect causes an initial render.
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <string>
 #include <map>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <vtkActor.h>
 #include <vtkCamera.h>
@@ -9,17 +15,12 @@
 #include <vtkLookupTable.h>
 #include <vtkNamedColors.h>
 #include <vtkNew.h>
-#include <vtkPointSource.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkProgrammableFilter.h>
 #include <vtkPiecewiseFunction.h>
 #include <vtkRenderWindow.h>
 #include <vtkSphereSource.h>
-#include <vtkStructuredGrid.h>
-#include <vtkSPHInterpolator.h>
-#include <vtkSPHQuinticKernel.h>
-#include <vtkImageData.h>
 #include <vtkPoints.h>
 #include <vtkRenderWindowInteractor.h>
 #include <vtkRenderer.h>
@@ -32,22 +33,43 @@
 #include <vtkVolume.h>
 #include <vtkVolumeProperty.h>
 
+#include "../data/Loader.h" // for ColumnSet
+#include "../data/Manifest.hxx"
 #include "../helper/helper.hxx"
 #include "../interactive/KeyPressInteractorStyle.hxx"
 #include "../interactive/TimeSliderCallback.hxx"
 #include "../interactive/ResizeWindowCallback.hxx"
-#include "../processing/AssignClusterFilter.hxx"
+#include "../interactive/TimestepSwapCallback.hxx"
+#include "../interactive/RenderCallback.hxx"
+#include "../interactive/InteractionCallback.hxx"
 #include "../processing/ParticleTypeFilter.hxx"
-#include "../processing/StarFilter.hxx"
-#include "../processing/BaryonFilter.hxx"
-#include "../processing/CalculateTemperatureFilter.hxx"
-#include "../processing/PolyDataToImageDataAlgorithm.hxx"
+#include "../processing/ParticleAttributesAlgorithm.hxx"
+#include "../processing/PointLODFilter.hxx"
+#include "../processing/PointVerticesFilter.hxx"
+#include "QualityGovernor.hxx"
+#include "SPHRefiner.hxx"
+#include "TimestepLoader.hxx"
 
 class vtkTextActor;
-class vtkXMLPolyDataReader;
+class SnapshotCache;
+class SpatialIndex;
 
 enum ParticleType { ALL, DARK_MATTER, BARYON };
 
+// Counters of the playback, reset after every report
+struct PlaybackStats {
+  int shown = 0;
+  // Frame slots in which the previous frame stayed on screen
+  int held = 0;
+  // Timesteps skipped to catch up with the clock
+  int dropped = 0;
+  double loadSeconds = 0;
+  double filterSeconds = 0;
+  // From requesting a timestep until it is swapped in
+  double latencySeconds = 0;
+  double renderSeconds = 0;
+};
+
 class VisCos {
 private:
   bool loaded = false;
@@ -55,6 +77,13 @@ private:
 
   // The currently active timestep of the data
   int active_timestep;
+  // Time of the data on screen, between two timesteps when interpolated
+  double active_time;
+  // The time which is prepared in the background
+  double requested_time;
+
+  // Whether odd and fractional steps are interpolated between snapshots
+  bool interpolating = false;
 
   // Number of steps to take when the slider was moved
   int steps = 40;
@@ -66,20 +95,56 @@ private:
   double sphOrigin[3] = { 19.4783, 42.6025, 36.4189 };
   double sphVolumeLengths[3] = { 2, 2, 2 };
   double sphOrientation[3] = { 0, 0, 1.0 };
-  // Resolution of the SPH box
-  int dimensions[3] = { 140, 140, 140 };
+  // Voxels per axis of the finest SPH volume, it is refined from a quarter
+  // and half of it
+  int sphResolution = 140;
+  bool sphEnabled = false;
+  // Whether the SPH box stays centered on the focal point
+  bool sphFollowing = false;
 
   std::string background_color;
   std::string data_folder_path;
   std::string cluster_path;
-  double tempRange[2];
-  std::map<int, vtkXMLPolyDataReader *> dataset_readers;
+  // Of the temperature colors, the sketches of the series replace it
+  double tempRange[2] = {0, 7000};
+
+  // Decoded snapshots, bounded by cacheBudget bytes
+  std::unique_ptr<SnapshotCache> snapshotCache;
+  size_t cacheBudget = 4096ul * 1024 * 1024;
+  // Snapshots and derived columns in float instead of double
+  bool singlePrecision = false;
+  int prefetchDistance = 2;
+  // Whether the particles are colored by phi, only then it is loaded
+  bool phiShown = false;
+
+  // Loads and filters timesteps in the background
+  std::unique_ptr<TimestepLoader> timestepLoader;
+  // The timestep the render pipeline currently shows (front buffer)
+  PreparedTimestep activeData;
+
+  // All available timesteps in ascending order
+  std::vector<int> timesteps;
+  std::map<int, std::filesystem::path> snapshotFiles;
+  // Metadata of the snapshots, empty without a manifest in the data folder
+  Manifest manifest;
+
+  // Playback through the timesteps
+  bool playing = false;
+  double playbackFps = 10.0;
+  std::chrono::steady_clock::time_point nextFrameTime;
+  // Slots since nextFrameTime already counted as held
+  int heldSlots = 0;
+  std::chrono::steady_clock::time_point lastPlaybackReport;
+  PlaybackStats playbackStats;
 
   // Maps point IDs to their cluster ID
-  std::map<int, int> clusters;
-  vtkXMLPolyDataReader *activeReader;
+  ClusterTable clusters;
+  // Clusters a timestep in the background (see ClusterActiveTimestep())
+  std::thread clusterWorker;
+  std::atomic<bool> clustering{false};
+  // Set by the worker once the table is written
+  std::atomic<bool> clustersWritten{false};
   vtkNew<vtkNamedColors> colors;
-  vtkNew<vtkPointSource> singlePointSource;
   vtkNew<vtkSphereSource> sphereSource;
 
   // For debugging stuff
@@ -95,6 +160,7 @@ private:
   vtkNew<vtkPolyDataMapper> starDataMapper;
 
   vtkSmartPointer<vtkLookupTable> tempLUT = GetTemperatureLUT();
+  vtkSmartPointer<vtkLookupTable> logTempLUT = GetLogTemperatureLUT();
   vtkSmartPointer<vtkLookupTable> clusterLUT = GetClusterLUT();
   vtkSmartPointer<vtkLookupTable> phiLUT = GetPhiLUT();
 
@@ -114,42 +180,41 @@ private:
   vtkNew<vtkSliderRepresentation2D> timeSliderRepr;
   vtkNew<vtkSliderWidget> timeSliderWidget;
 
-  // Filters
-  TempFilterParams temperatureFilterParams;
-  vtkNew<vtkProgrammableFilter> temperatureFilter;
-
-  AssignClusterParams clusterFilterParams;
-  vtkNew<vtkProgrammableFilter> clusterFilter;
-
+  // Filters (temperature, clusters, stars and baryons run in timestepLoader)
   ParticleTypeFilterParams particleFilterParams;
   vtkNew<vtkProgrammableFilter> particleTypeFilter;
-
-  StarFilterParams starFilterParams;
-  vtkNew<vtkProgrammableFilter> starFilter;
-
-  BaryonFilterParams baryonFilterParams;
-  vtkNew<vtkProgrammableFilter> baryonFilter;
+  // Subsamples the visible particles by the distance to the camera
+  vtkNew<PointLODFilter> particleLOD;
+  vtkIdType pointBudget = 2000000;
+
+  // Lowers the particles drawn and the SPH samples while the camera moves
+  QualityGovernor governor;
+  // Sample distance of the SPH volume at full quality
+  float sphSampleDistance = -1;
+  // A frame was requested and is rendered on the next tick
+  bool renderPending = false;
+  std::chrono::steady_clock::time_point renderStart;
 
   // Various
-  vtkNew<vtkGlyph3D> glyph3D;
+  vtkNew<PointVerticesFilter> particleVertices;
   vtkNew<vtkGlyph3D> starGlyph3D;
-  vtkNew<vtkGlyph3D> markedGlyph3D;
+  vtkNew<PointVerticesFilter> markedVertices;
   vtkNew<vtkCamera> camera;
   vtkNew<KeyPressInteractorStyle> keyboardInteractorStyle;
 
   // Used for SPH
-  vtkNew<vtkSPHQuinticKernel> kernel;
-  vtkSmartPointer<vtkStructuredGrid> source;
-  vtkNew<vtkSPHInterpolator> interpolator;
+  // Splats the SPH volume progressively in the background
+  std::unique_ptr<SPHRefiner> sphRefiner;
   vtkNew<vtkVolumeProperty> volumeProperty;
   vtkNew<vtkSmartVolumeMapper> volumeMapper;
   vtkNew<vtkVolume> volume;
-  vtkNew<PolyDataToImageDataAlgorithm> polyDataToImageDataAlgorithm;
-  vtkNew<vtkImageData> imageData;
   vtkNew<vtkPiecewiseFunction> opacityFunction;
 
   vtkNew<TimeSliderCallback> timeSliderCallback;
   vtkNew<ResizeWindowCallback> resizeCallback;
+  vtkNew<TimestepSwapCallback> timestepSwapCallback;
+  vtkNew<RenderCallback> renderCallback;
+  vtkNew<InteractionCallback> interactionCallback;
 
   vtkTextActor* textVisibleParticles;
   vtkTextActor* textBaryon;
@@ -159,23 +224,69 @@ private:
   vtkTextActor* textBaryonStarForming;
   vtkTextActor* textAGN;
 
+  double NextPlaybackTime(double time, int frames);
+  std::shared_ptr<const ClusterTable> LoadClusterTable(int step);
+  // The spatial index of the snapshot on screen, nullptr until the loader
+  // built it (which this starts) or while an interpolated time is shown
+  std::shared_ptr<const SpatialIndex> ActiveIndex();
+  void RequestSPH();
+  // Sets the point budget and SPH sample distance for the current quality
+  void ApplyQuality();
 
 public:
   VisCos(int initial_active_timestep, std::string data_folder_path,
          std::string cluster_path);
+  ~VisCos();
   void Load();
   void MoveForward(int steps);
   void MoveBackward(int steps);
   void MoveToTimestep(int step);
+  void MoveToTime(double time);
+  void SwapInPreparedTimestep();
+  void ShowPreparedTimestep(PreparedTimestep &prepared);
+
+  bool IsPlaying();
+  void StartPlayback();
+  void StopPlayback();
+  void TogglePlayback();
+  void SetPlaybackFps(double fps);
+  double GetPlaybackFps();
+  void PlaybackTick();
+  void ReportPlayback();
+
+  bool IsInterpolating();
+  void ToggleInterpolation();
 
   void ShowTemperature();
+  void ShowLogTemperature();
   void ShowClusters();
+  // Clusters the timestep on screen in the background
+  void ClusterActiveTimestep();
+  // Shows the clusters once ClusterActiveTimestep() finished
+  void SwapInClusters();
   void ShowPhi();
+  // The point arrays of the snapshots the views currently need
+  ColumnSet RequiredColumns();
+  // Passes them on to the cache, returns true if the timestep on screen
+  // lacks some of them
+  bool UpdateColumns();
 
   void SetupPipeline();
 
   void SetBackgroundColor(std::string color);
 
+  void SetCacheBudget(size_t bytes);
+  void SetPrefetchDistance(int distance);
+  // Lowers the prefetch distance if the snapshots would not fit the budget
+  void FitPrefetchToBudget();
+  // Takes the color ranges from the quantile sketches of the data folder
+  void ApplySketchedRanges();
+  // Shows what the manifest knows about the snapshot of the time on the
+  // slider
+  void UpdateSliderTitle(double time);
+  // Before Load()
+  void SetSinglePrecision(bool single);
+
   void moreSteps();
   void lessSteps();
 
@@ -216,9 +327,33 @@ public:
   void EnableSPH();
   void DisableSPH();
   void UpdateSPH();
+  void SwapInSPHVolume();
+  void SetSPHResolution(int resolution);
+  // Most particles drawn per frame, the rest is left out by distance
+  void SetPointBudget(vtkIdType budget);
+
+  // Frame rate aimed at while moving the camera
+  void SetTargetFps(double fps);
+
+  // Called before and after every render
+  void BeforeRender();
+  void AfterRender();
+
+  // The camera was moved, the frame is rendered with RenderPendingFrame()
+  // at reduced quality
+  void RequestRender();
+  void RenderPendingFrame();
+  // Trackball interaction
+  void BeginInteraction();
+  void EndInteraction();
+  // Moves the SPH box along with the focal point
+  void ToggleSPHFollow();
 
   void UpdateFP();
   void AddMarkedPoint(double pos[3]);
+  // Picks the particle closest to pos on the spatial index of the active
+  // snapshot and counts the particles within maxRadius
+  void PickParticle(const double pos[3], double maxRadius);
   void SetSPHOrientation(double *orient);
   double *GetSPHOrientation();
 
@@ -0,0 +1,283 @@
+#include <algorithm> // for max, min, sort, copy
+#include <atomic>
+#include <cmath>   // for cbrt
+#include <filesystem>
+#include <memory> // for unique_ptr
+#include <fstream>
+#include <stdexcept> // for runtime_error
+#include <stdint.h>
+#include <stdio.h>
+#include <utility> // for swap
+#include <vector>
+
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkType.h> // for vtkIdType
+
+#include "Clustering.hxx"
+#include "SpatialIndex.hxx"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char CLUSTERS_MAGIC[8] = {'V', 'C', 'L', 'U', 'S', '0', '2', '\0'};
+
+struct ClusterTableHeader {
+  char magic[8];
+  int64_t numIds;
+};
+
+// Union-find which can be merged from several threads at once
+class ConcurrentUnionFind {
+public:
+  explicit ConcurrentUnionFind(vtkIdType n) : parent(n) {
+    for (vtkIdType i = 0; i < n; i++) {
+      parent[i].store(i, std::memory_order_relaxed);
+    }
+  }
+
+  vtkIdType Find(vtkIdType x) {
+    while (true) {
+      vtkIdType p = parent[x].load();
+      if (p == x) {
+        return x;
+      }
+      // Path halving
+      vtkIdType gp = parent[p].load();
+      if (p != gp) {
+        parent[x].compare_exchange_weak(p, gp);
+      }
+      x = gp;
+    }
+  }
+
+  void Union(vtkIdType a, vtkIdType b) {
+    while (true) {
+      a = Find(a);
+      b = Find(b);
+      if (a == b) {
+        return;
+      }
+      // Always link the larger root below the smaller one, so no cycles
+      // can form between concurrent unions
+      if (a < b) {
+        std::swap(a, b);
+      }
+      vtkIdType expected = a;
+      if (parent[a].compare_exchange_weak(expected, b)) {
+        return;
+      }
+    }
+  }
+
+private:
+  std::vector<std::atomic<vtkIdType>> parent;
+};
+
+} // namespace
+
+std::vector<int> find_clusters(vtkPolyData *snapshot,
+                               const ClusteringParams &params,
+                               const SpatialIndex *index) {
+  vtkIdType n = snapshot->GetNumberOfPoints();
+  std::vector<int> labels(n, -1);
+  if (n == 0) {
+    return labels;
+  }
+
+  double radius = params.linkingLength;
+  if (radius <= 0) {
+    double volume = params.boxSize > 0
+                        ? params.boxSize * params.boxSize * params.boxSize
+                        : 0;
+    if (volume <= 0) {
+      double bounds[6];
+      snapshot->GetBounds(bounds);
+      volume = (bounds[1] - bounds[0]) * (bounds[3] - bounds[2]) *
+               (bounds[5] - bounds[4]);
+    }
+    radius = 0.2 * std::cbrt(volume / n);
+  }
+
+  // The points are visited in cell order, so neighbouring points are
+  // processed by the same thread
+  std::unique_ptr<SpatialIndex> ownIndex;
+  if (index == nullptr || index->GetNumberOfPoints() != n) {
+    ownIndex = std::make_unique<SpatialIndex>(snapshot, radius, params.boxSize);
+    index = ownIndex.get();
+  }
+  auto neighbors = [&](vtkIdType k, auto f) {
+    const float *p = index->GetPosition(k);
+    double center[3] = {p[0], p[1], p[2]};
+    index->ForEachInSphere(center, radius,
+                           [&](vtkIdType j, const double *) { return f(j); });
+  };
+
+  ConcurrentUnionFind groups(n);
+
+  bool dbscan = params.algorithm == ClusterAlgorithm::DBSCAN;
+
+  // DBSCAN only links core points, FOF links all points
+  std::vector<char> core(n, 1);
+  if (dbscan) {
+    auto findCore = [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType k = begin; k < end; k++) {
+        vtkIdType i = index->GetId(k);
+        int count = 0;
+        neighbors(k, [&](vtkIdType) {
+          return ++count < params.minPoints;
+        });
+        core[i] = count >= params.minPoints;
+      }
+    };
+    vtkSMPTools::For(0, n, findCore);
+  }
+
+  auto link = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType k = begin; k < end; k++) {
+      vtkIdType i = index->GetId(k);
+      if (!core[i]) {
+        continue;
+      }
+      neighbors(k, [&](vtkIdType j) {
+        // Every pair is seen from both sides, link it once
+        if (j > i && core[j]) {
+          groups.Union(i, j);
+        }
+        return true;
+      });
+    }
+  };
+  vtkSMPTools::For(0, n, link);
+
+  // Root of the group of every point, -1 for noise
+  std::vector<vtkIdType> root(n, -1);
+  auto resolve = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType k = begin; k < end; k++) {
+      vtkIdType i = index->GetId(k);
+      if (core[i]) {
+        root[i] = groups.Find(i);
+        continue;
+      }
+      // DBSCAN border points join the cluster of any core neighbour
+      neighbors(k, [&](vtkIdType j) {
+        if (core[j]) {
+          root[i] = groups.Find(j);
+          return false;
+        }
+        return true;
+      });
+    }
+  };
+  vtkSMPTools::For(0, n, resolve);
+
+  // Number the groups by their size
+  std::vector<vtkIdType> size(n, 0);
+  for (vtkIdType i = 0; i < n; i++) {
+    if (root[i] >= 0) {
+      size[root[i]]++;
+    }
+  }
+
+  int minSize = dbscan ? 1 : params.minPoints;
+  std::vector<vtkIdType> roots;
+  for (vtkIdType i = 0; i < n; i++) {
+    if (size[i] >= minSize) {
+      roots.push_back(i);
+    }
+  }
+  std::sort(roots.begin(), roots.end(), [&](vtkIdType a, vtkIdType b) {
+    return size[a] > size[b] || (size[a] == size[b] && a < b);
+  });
+
+  std::vector<int> clusterOfRoot(n, -1);
+  for (size_t k = 0; k < roots.size(); k++) {
+    clusterOfRoot[roots[k]] = static_cast<int>(k);
+  }
+  for (vtkIdType i = 0; i < n; i++) {
+    if (root[i] >= 0) {
+      labels[i] = clusterOfRoot[root[i]];
+    }
+  }
+
+  printf("[Clustering]: %lu clusters (linking length %f)\n", roots.size(),
+         radius);
+
+  return labels;
+}
+
+fs::path cluster_table_path(const fs::path &vtp_path) {
+  fs::path path(vtp_path);
+  return path.replace_extension(".clusters");
+}
+
+void write_cluster_table(vtkPolyData *snapshot, const std::vector<int> &labels,
+                         const fs::path &out_path) {
+  vtkDataArray *ids = snapshot->GetPointData()->GetArray("id");
+  if (ids == nullptr) {
+    throw std::runtime_error("The snapshot has no id array");
+  }
+
+  const auto range = vtk::DataArrayValueRange<1>(ids);
+  vtkIdType maxId = -1;
+  for (auto id : range) {
+    maxId = std::max(maxId, static_cast<vtkIdType>(id));
+  }
+
+  std::vector<int32_t> table(maxId + 1, -1);
+  vtkIdType i = 0;
+  for (auto id : range) {
+    vtkIdType index = static_cast<vtkIdType>(id);
+    if (index >= 0) {
+      table[index] = labels[i];
+    }
+    i++;
+  }
+
+  ClusterTableHeader header{};
+  std::copy(CLUSTERS_MAGIC, CLUSTERS_MAGIC + 8, header.magic);
+  header.numIds = static_cast<int64_t>(table.size());
+
+  fs::path tmp_path(out_path);
+  tmp_path += ".tmp";
+
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Unable to write " + tmp_path.string());
+  }
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(table.data()),
+            table.size() * sizeof(int32_t));
+  out.close();
+
+  if (!out) {
+    throw std::runtime_error("Failed writing " + tmp_path.string());
+  }
+  fs::rename(tmp_path, out_path);
+}
+
+std::vector<int32_t> load_cluster_table(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Unable to open " + path.string());
+  }
+
+  ClusterTableHeader header;
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!in || !std::equal(CLUSTERS_MAGIC, CLUSTERS_MAGIC + 8, header.magic) ||
+      header.numIds < 0) {
+    throw std::runtime_error(path.string() + " is not a cluster table");
+  }
+
+  std::vector<int32_t> table(header.numIds);
+  in.read(reinterpret_cast<char *>(table.data()),
+          table.size() * sizeof(int32_t));
+  if (!in) {
+    throw std::runtime_error(path.string() + " is truncated");
+  }
+  return table;
+}
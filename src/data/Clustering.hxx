@@ -0,0 +1,59 @@
+#pragma once
+
+#include <filesystem>
+#include <stdint.h>
+#include <vector>
+
+class SpatialIndex;
+class vtkPolyData;
+
+namespace fs = std::filesystem;
+
+enum class ClusterAlgorithm { FOF, DBSCAN };
+
+struct ClusteringParams {
+  ClusterAlgorithm algorithm = ClusterAlgorithm::FOF;
+
+  // Linking length (FOF) or eps (DBSCAN) in Mpc/h. With 0 the usual 0.2 of
+  // the mean interparticle separation is taken.
+  double linkingLength = 0;
+
+  // FOF: smallest group which is a cluster, all smaller ones are noise.
+  // DBSCAN: neighbours (including the point itself) of a core point.
+  int minPoints = 20;
+
+  // Edge length of the periodic box, 0 for non periodic data
+  double boxSize = 64.0;
+};
+
+/*
+  Clusters the points of the snapshot with friends-of-friends or DBSCAN.
+
+  Neighbours are found with the given spatial index of the snapshot (built
+  for the same box), without one an index with cells one linking length
+  wide is built. The neighbour search runs in parallel and the groups are merged with a lock free union-find.
+
+  Returns the cluster of every point (in point order), -1 for noise. The
+  clusters are numbered by their size, 0 being the largest.
+*/
+std::vector<int> find_clusters(vtkPolyData *snapshot,
+                               const ClusteringParams &params,
+                               const SpatialIndex *index = nullptr);
+
+/*
+  Cluster tables
+
+  The clusters of a snapshot are stored next to it in a ".clusters" file,
+  indexed by the particle id (not the point order), so they are independent
+  of the order of the points in the snapshot.
+*/
+
+// Path of the cluster table belonging to the given .vtp file
+fs::path cluster_table_path(const fs::path &vtp_path);
+
+// Writes the clusters of the snapshot, labels are in point order
+void write_cluster_table(vtkPolyData *snapshot, const std::vector<int> &labels,
+                         const fs::path &out_path);
+
+// Reads a cluster table, the cluster of every id (-1 for noise)
+std::vector<int32_t> load_cluster_table(const fs::path &path);
@@ -1,12 +1,45 @@
+#include <algorithm> // for copy, equal
 #include <cstdlib> // for atoi
+#include <cstring> // for strncpy
 #include <filesystem>
+#include <fstream>
+#include <iterator> // for next
 #include <map>
+#include <mutex>
 #include <regex>
 #include <stdexcept> // for runtime_error
+#include <stdint.h>
+#include <stdio.h>
 #include <string>
+#include <system_error> // for error_code
+#include <utility>
 #include <vector>
 // IWYU pragma: no_include <bits/chrono.h>
 
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for pread, close, sysconf
+
+#include <vtkAbstractArray.h>
+#include <vtkDataArraySelection.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLPolyDataReader.h>
+
+#include "Loader.h"
+#include "Manifest.hxx"
+#include "VTPDecoder.hxx"
+
 namespace fs = std::filesystem;
 
 std::map<int, fs::path>
@@ -18,6 +51,17 @@ load_cosmology_dataset(std::string data_folder_path) {
                              " does not exist!");
   }
 
+  // The .series file lists the snapshots, only without it the folder is
+  // scanned
+  fs::path series = series_path(folder);
+  if (fs::exists(series)) {
+    std::map<int, fs::path> listed = read_series(series);
+    for (auto it = listed.begin(); it != listed.end();) {
+      it = fs::exists(it->second) ? std::next(it) : listed.erase(it);
+    }
+    return listed;
+  }
+
   const std::regex vtk_cosmo_file(".*Full\\.cosmo\\.([\\d]{3})\\.vtp$");
   std::map<int, fs::path> ts_to_path;
 
@@ -34,3 +78,395 @@ load_cosmology_dataset(std::string data_folder_path) {
 
   return ts_to_path;
 }
+
+/*
+  Layout of a columnar file:
+    * ColumnarHeader
+    * ColumnarEntry[numColumns]
+    * the raw column data, each column aligned to COLUMN_ALIGNMENT bytes
+*/
+namespace {
+
+const char COLUMNAR_MAGIC[8] = {'V', 'C', 'O', 'L', 'S', '0', '1', '\0'};
+const uint64_t COLUMN_ALIGNMENT = 64;
+
+enum ColumnKind : int32_t { POINT_ARRAY = 0, POINTS = 1 };
+
+// Flags of the header. Files written before there were flags have none,
+// they hold the columns of the .vtp file unchanged.
+const uint32_t COLUMNAR_FLOAT32 = 1;
+
+struct ColumnarHeader {
+  char magic[8];
+  uint32_t numColumns;
+  uint32_t flags;
+  int64_t numPoints;
+  double time;
+};
+
+struct ColumnarEntry {
+  char name[48];
+  int32_t kind;
+  int32_t dataType;
+  int32_t numComponents;
+  int32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+// Maps the start of each column to its mapping (base address and length)
+// so that the arrays can unmap their memory once they are deleted.
+std::mutex mappingsMutex;
+std::map<void *, std::pair<void *, size_t>> mappings;
+
+void unmap_column(void *data) {
+  std::pair<void *, size_t> mapping;
+  {
+    std::lock_guard<std::mutex> lock(mappingsMutex);
+    auto it = mappings.find(data);
+    if (it == mappings.end()) {
+      return;
+    }
+    mapping = it->second;
+    mappings.erase(it);
+  }
+  munmap(mapping.first, mapping.second);
+}
+
+uint64_t align(uint64_t offset) {
+  return (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+}
+
+ColumnarEntry make_entry(vtkDataArray *arr, const char *name, int32_t kind) {
+  ColumnarEntry entry{};
+  strncpy(entry.name, name, sizeof(entry.name) - 1);
+  entry.kind = kind;
+  entry.dataType = arr->GetDataType();
+  entry.numComponents = arr->GetNumberOfComponents();
+  entry.size = static_cast<uint64_t>(arr->GetNumberOfValues()) *
+               arr->GetDataTypeSize();
+  return entry;
+}
+
+} // namespace
+
+fs::path columnar_snapshot_path(const fs::path &vtp_path) {
+  fs::path path(vtp_path);
+  return path.replace_extension(".cols");
+}
+
+bool columnar_snapshot_is_current(const fs::path &vtp_path) {
+  fs::path columnar = columnar_snapshot_path(vtp_path);
+  std::error_code error;
+  auto converted = fs::last_write_time(columnar, error);
+  if (error) {
+    return false;
+  }
+  auto written = fs::last_write_time(vtp_path, error);
+  return !error && converted >= written;
+}
+
+bool columnar_snapshot_is_float32(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  ColumnarHeader header;
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  return in && std::equal(COLUMNAR_MAGIC, COLUMNAR_MAGIC + 8, header.magic) &&
+         (header.flags & COLUMNAR_FLOAT32) != 0;
+}
+
+void write_columnar_snapshot(vtkPolyData *snapshot, double time,
+                             const fs::path &out_path, bool float32) {
+  std::vector<vtkDataArray *> arrays;
+  std::vector<ColumnarEntry> entries;
+
+  vtkDataArray *points = snapshot->GetPoints()->GetData();
+  arrays.push_back(points);
+  entries.push_back(make_entry(points, "Points", POINTS));
+
+  vtkPointData *pd = snapshot->GetPointData();
+  for (int i = 0; i < pd->GetNumberOfArrays(); i++) {
+    vtkDataArray *arr = pd->GetArray(i);
+    if (arr == nullptr || arr->GetName() == nullptr) {
+      continue;
+    }
+    arrays.push_back(arr);
+    entries.push_back(make_entry(arr, arr->GetName(), POINT_ARRAY));
+  }
+
+  ColumnarHeader header{};
+  std::copy(COLUMNAR_MAGIC, COLUMNAR_MAGIC + 8, header.magic);
+  header.numColumns = static_cast<uint32_t>(entries.size());
+  header.flags = float32 ? COLUMNAR_FLOAT32 : 0;
+  header.numPoints = snapshot->GetNumberOfPoints();
+  header.time = time;
+
+  uint64_t offset =
+      align(sizeof(ColumnarHeader) + entries.size() * sizeof(ColumnarEntry));
+  for (auto &entry : entries) {
+    entry.offset = offset;
+    offset = align(offset + entry.size);
+  }
+
+  // Write into a temporary file first so that an interrupted conversion
+  // never leaves a truncated cache file behind.
+  fs::path tmp_path(out_path);
+  tmp_path += ".tmp";
+
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Unable to write " + tmp_path.string());
+  }
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(entries.data()),
+            entries.size() * sizeof(ColumnarEntry));
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    out.seekp(entries[i].offset);
+    out.write(static_cast<const char *>(arrays[i]->GetVoidPointer(0)),
+              entries[i].size);
+  }
+  out.close();
+
+  if (!out) {
+    throw std::runtime_error("Failed writing " + tmp_path.string());
+  }
+  fs::rename(tmp_path, out_path);
+}
+
+namespace {
+
+// Float copy of a double array, nullptr for all other arrays
+vtkSmartPointer<vtkFloatArray> NarrowArray(vtkDataArray *array) {
+  vtkDoubleArray *source = vtkDoubleArray::SafeDownCast(array);
+  if (source == nullptr) {
+    return nullptr;
+  }
+
+  vtkSmartPointer<vtkFloatArray> narrowed =
+      vtkSmartPointer<vtkFloatArray>::New();
+  narrowed->SetName(source->GetName());
+  narrowed->SetNumberOfComponents(source->GetNumberOfComponents());
+  narrowed->SetNumberOfTuples(source->GetNumberOfTuples());
+
+  const double *in = source->GetPointer(0);
+  float *out = narrowed->GetPointer(0);
+  auto copy = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; i++) {
+      out[i] = static_cast<float>(in[i]);
+    }
+  };
+  vtkSMPTools::For(0, source->GetNumberOfValues(), copy);
+  return narrowed;
+}
+
+// Reads a .vtp file with the parallel decoder, files it does not handle are
+// read by vtkXMLPolyDataReader
+vtkSmartPointer<vtkPolyData> ReadVTP(const fs::path &vtp_path,
+                                     const ColumnSet &columns) {
+  try {
+    return read_vtp_parallel(vtp_path, columns);
+  } catch (const std::runtime_error &e) {
+    printf("[Loader]: %s: %s, using vtkXMLPolyDataReader\n", vtp_path.c_str(),
+           e.what());
+  }
+
+  // A fresh reader per load so that the decoded output is owned by the
+  // caller alone and several snapshots can be read concurrently.
+  vtkNew<vtkXMLPolyDataReader> reader;
+  reader->SetFileName(vtp_path.c_str());
+  if (!columns.empty()) {
+    // The arrays are known once the header was read, the disabled ones are
+    // skipped without inflating them
+    reader->UpdateInformation();
+    vtkDataArraySelection *selection = reader->GetPointDataArraySelection();
+    selection->DisableAllArrays();
+    for (const std::string &column : columns) {
+      selection->EnableArray(column.c_str());
+    }
+  }
+  reader->Update();
+  return reader->GetOutput();
+}
+
+} // namespace
+
+void narrow_to_float32(vtkPolyData *snapshot) {
+  vtkPoints *points = snapshot->GetPoints();
+  if (points != nullptr) {
+    if (vtkSmartPointer<vtkFloatArray> narrowed = NarrowArray(points->GetData())) {
+      points->SetData(narrowed);
+    }
+  }
+
+  vtkPointData *pd = snapshot->GetPointData();
+  for (int i = 0; i < pd->GetNumberOfArrays(); i++) {
+    vtkDataArray *array = pd->GetArray(i);
+    vtkSmartPointer<vtkFloatArray> narrowed = NarrowArray(array);
+    if (narrowed == nullptr) {
+      continue;
+    }
+    bool scalars = pd->GetScalars() == array;
+    // Replaces the array of the same name in place
+    pd->AddArray(narrowed);
+    if (scalars) {
+      pd->SetActiveScalars(narrowed->GetName());
+    }
+  }
+}
+
+void convert_to_columnar(int timestep, const fs::path &vtp_path, bool float32) {
+  vtkSmartPointer<vtkPolyData> data = ReadVTP(vtp_path, {});
+  vtkInformation *info = data->GetInformation();
+
+  // The temperature filter derives the redshift from the timestep
+  double time = timestep;
+  if (info->Has(vtkDataObject::DATA_TIME_STEP())) {
+    time = info->Get(vtkDataObject::DATA_TIME_STEP());
+  }
+  if (float32) {
+    narrow_to_float32(data);
+  }
+
+  write_columnar_snapshot(data, time, columnar_snapshot_path(vtp_path),
+                          float32);
+}
+
+vtkSmartPointer<vtkPolyData> load_columnar_snapshot(const fs::path &path,
+                                                    const ColumnSet &columns) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open " + path.string());
+  }
+
+  ColumnarHeader header;
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      !std::equal(COLUMNAR_MAGIC, COLUMNAR_MAGIC + 8, header.magic)) {
+    close(fd);
+    throw std::runtime_error(path.string() + " is not a columnar snapshot");
+  }
+
+  // Mapping past the end of the file would fault on the first access, so
+  // every column has to lie within the file
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Unable to stat " + path.string());
+  }
+  const uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+  if (header.numPoints < 0 ||
+      header.numColumns > (fileSize - sizeof(header)) / sizeof(ColumnarEntry)) {
+    close(fd);
+    throw std::runtime_error(path.string() + " is truncated");
+  }
+
+  std::vector<ColumnarEntry> entries(header.numColumns);
+  ssize_t entriesSize = header.numColumns * sizeof(ColumnarEntry);
+  if (pread(fd, entries.data(), entriesSize, sizeof(header)) != entriesSize) {
+    close(fd);
+    throw std::runtime_error(path.string() + " is truncated");
+  }
+
+  for (auto &entry : entries) {
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    int typeSize = vtkDataArray::GetDataTypeSize(entry.dataType);
+    uint64_t expected = static_cast<uint64_t>(header.numPoints) *
+                        entry.numComponents * typeSize;
+    if (typeSize <= 0 || entry.numComponents <= 0 || entry.size != expected ||
+        entry.offset > fileSize || entry.size > fileSize - entry.offset) {
+      close(fd);
+      throw std::runtime_error("Column " + std::string(entry.name) + " of " +
+                               path.string() + " does not fit the file");
+    }
+  }
+
+  const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  for (const auto &entry : entries) {
+    // Unmapped columns cost neither address space nor page cache
+    if (entry.kind != POINTS && !columns.empty() &&
+        !columns.count(entry.name)) {
+      continue;
+    }
+
+    vtkSmartPointer<vtkDataArray> arr = vtkSmartPointer<vtkDataArray>::Take(
+        vtkDataArray::CreateDataArray(entry.dataType));
+    arr->SetNumberOfComponents(entry.numComponents);
+    arr->SetName(entry.name);
+
+    if (entry.size > 0) {
+      // mmap needs a page aligned offset, the columns are only aligned to
+      // COLUMN_ALIGNMENT bytes.
+      uint64_t base = entry.offset / page * page;
+      size_t length = entry.size + (entry.offset - base);
+      void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE, fd, static_cast<off_t>(base));
+      if (mapping == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Unable to map " + std::string(entry.name) +
+                                 " of " + path.string());
+      }
+      void *data = static_cast<char *>(mapping) + (entry.offset - base);
+      {
+        std::lock_guard<std::mutex> lock(mappingsMutex);
+        mappings.insert_or_assign(data, std::make_pair(mapping, length));
+      }
+
+      arr->SetVoidArray(data, header.numPoints * entry.numComponents, 0,
+                        vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+      arr->SetArrayFreeFunction(unmap_column);
+    }
+
+    if (entry.kind == POINTS) {
+      vtkNew<vtkPoints> points;
+      points->SetData(arr);
+      output->SetPoints(points);
+    } else {
+      output->GetPointData()->AddArray(arr);
+    }
+  }
+  close(fd);
+
+  output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), header.time);
+
+  return output;
+}
+
+vtkSmartPointer<vtkPolyData> load_snapshot(int timestep,
+                                           const fs::path &vtp_path,
+                                           bool float32,
+                                           const ColumnSet &columns) {
+  fs::path columnar = columnar_snapshot_path(vtp_path);
+  // A float32 file can not give back the double precision of the .vtp file
+  bool usable = columnar_snapshot_is_current(vtp_path);
+  if (usable && !float32 && columnar_snapshot_is_float32(columnar)) {
+    printf("[Loader]: %s holds float32 columns, reading %s for double "
+           "precision\n",
+           columnar.c_str(), vtp_path.c_str());
+    usable = false;
+  }
+  if (usable) {
+    try {
+      vtkSmartPointer<vtkPolyData> output =
+          load_columnar_snapshot(columnar, columns);
+      if (float32) {
+        narrow_to_float32(output);
+      }
+      return output;
+    } catch (const std::runtime_error &e) {
+      printf("[Loader]: %s, reading %s instead\n", e.what(),
+             vtp_path.c_str());
+    }
+  }
+
+  vtkSmartPointer<vtkPolyData> output = ReadVTP(vtp_path, columns);
+  vtkInformation *info = output->GetInformation();
+  if (!info->Has(vtkDataObject::DATA_TIME_STEP())) {
+    info->Set(vtkDataObject::DATA_TIME_STEP(), timestep);
+  }
+  if (float32) {
+    narrow_to_float32(output);
+  }
+  return output;
+}
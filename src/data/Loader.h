@@ -2,9 +2,73 @@
 
 #include <filesystem>
 #include <map>
+#include <set>
 #include <string>
 
+#include <vtkSmartPointer.h>
+
+class vtkPolyData;
+
 namespace fs = std::filesystem;
 
+// Names of the point arrays to read of a snapshot, empty for all of them
+using ColumnSet = std::set<std::string>;
+
+// The snapshots of the folder by timestep, as listed by its .series file
+// (the folder is only scanned for Full.cosmo.NNN.vtp files without one)
 std::map<int, fs::path>
 load_cosmology_dataset(std::string data_folder_path);
+
+/*
+  Columnar snapshot cache
+
+  Each snapshot can be converted once into a ".cols" file which stores every
+  point array (and the points) as one contiguous, uncompressed column. Loading
+  such a file maps the columns into memory and wraps them without copying, so
+  switching timesteps costs page faults instead of XML parsing and inflation.
+*/
+
+// Path of the columnar file belonging to the given .vtp file
+fs::path columnar_snapshot_path(const fs::path &vtp_path);
+
+// Whether the columnar file of the .vtp file exists and is not older than it
+bool columnar_snapshot_is_current(const fs::path &vtp_path);
+
+// Whether the columnar file was written with float32 (its double columns
+// narrowed to floats), false if it can not be read
+bool columnar_snapshot_is_float32(const fs::path &path);
+
+// Writes all point arrays of the snapshot into a columnar file, float32
+// records that they were narrowed to floats
+void write_columnar_snapshot(vtkPolyData *snapshot, double time,
+                             const fs::path &out_path, bool float32 = false);
+
+// Reads the .vtp file at the given timestep and writes its columnar file,
+// with float32 all double columns are stored as floats
+void convert_to_columnar(int timestep, const fs::path &vtp_path,
+                         bool float32 = false);
+
+// Loads a snapshot, from its columnar file if it is current and valid (and
+// not float32 unless float32 is requested). With float32 the double columns
+// are narrowed to floats (see below). Only the point arrays in columns are
+// read (the points always are), the others are neither decoded nor mapped.
+vtkSmartPointer<vtkPolyData> load_snapshot(int timestep,
+                                           const fs::path &vtp_path,
+                                           bool float32 = false,
+                                           const ColumnSet &columns = {});
+
+/*
+  Single precision mode
+
+  Replaces the points and all double point arrays of the snapshot with float
+  copies. Rendering, the LUTs and SPH need no more than float, so this
+  halves the bytes of these columns in the cache and for the upload to the
+  mapper. Integer columns (id, mask) are left alone.
+*/
+void narrow_to_float32(vtkPolyData *snapshot);
+
+// Maps a columnar file into memory. The arrays of the returned vtkPolyData
+// point directly into the mapping. Only the columns in columns are mapped.
+// A file whose columns do not fit its size raises a std::runtime_error.
+vtkSmartPointer<vtkPolyData>
+load_columnar_snapshot(const fs::path &path, const ColumnSet &columns = {});
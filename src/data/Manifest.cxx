@@ -0,0 +1,309 @@
+#include <algorithm> // for min, max
+#include <cmath>     // for isnan, lround
+#include <fstream>
+#include <iterator> // for istreambuf_iterator
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept> // for runtime_error
+#include <stdio.h>
+#include <stdlib.h> // for strtod, strtoll
+#include <system_error> // for error_code
+
+#include <vtkAbstractArray.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkType.h> // for VTK_DOUBLE, VTK_FLOAT
+
+#include "Manifest.hxx"
+#include "VTPDecoder.hxx"
+
+namespace {
+
+const char MANIFEST_MAGIC[] = "VisCosManifest 1";
+
+ArraySummary Summarize(const VTPArrayHeader &header, vtkDataArray *decoded) {
+  ArraySummary summary{header.name, header.dataType, header.numComponents,
+                       {header.range[0], header.range[1]}, header.offset};
+  // Files written without ranges need the decoded array
+  if (std::isnan(summary.range[0]) && decoded != nullptr) {
+    decoded->GetRange(summary.range, summary.numComponents > 1 ? -1 : 0);
+  }
+  return summary;
+}
+
+void WriteArray(std::ostream &out, const char *kind,
+                const ArraySummary &array) {
+  out << kind << ' ' << array.dataType << ' ' << array.numComponents << ' '
+      << array.range[0] << ' ' << array.range[1] << ' ' << array.offset;
+}
+
+// strtod and strtoll also read the "nan" of ranges unknown at build time
+double ReadDouble(std::istream &in) {
+  std::string token;
+  in >> token;
+  return strtod(token.c_str(), nullptr);
+}
+
+int64_t ReadInt(std::istream &in) {
+  std::string token;
+  in >> token;
+  return strtoll(token.c_str(), nullptr, 10);
+}
+
+ArraySummary ReadArray(std::istream &in) {
+  ArraySummary array;
+  array.dataType = static_cast<int>(ReadInt(in));
+  array.numComponents = static_cast<int>(ReadInt(in));
+  array.range[0] = ReadDouble(in);
+  array.range[1] = ReadDouble(in);
+  array.offset = static_cast<uint64_t>(ReadInt(in));
+  return array;
+}
+
+// The rest of the line, names and paths may contain spaces
+std::string ReadRest(std::istream &in) {
+  std::string rest;
+  std::getline(in >> std::ws, rest);
+  return rest;
+}
+
+} // namespace
+
+const ArraySummary *SnapshotSummary::FindArray(const std::string &name) const {
+  for (const ArraySummary &array : arrays) {
+    if (array.name == name) {
+      return &array;
+    }
+  }
+  return nullptr;
+}
+
+size_t SnapshotSummary::DecodedSize(const ColumnSet &columns,
+                                    bool float32) const {
+  auto bytes = [this, float32](const ArraySummary &array) {
+    int type = float32 && array.dataType == VTK_DOUBLE ? VTK_FLOAT
+                                                        : array.dataType;
+    return static_cast<size_t>(numPoints) * array.numComponents *
+           vtkAbstractArray::GetDataTypeSize(type);
+  };
+
+  size_t size = bytes(points);
+  for (const ArraySummary &array : arrays) {
+    if (columns.empty() || columns.count(array.name)) {
+      size += bytes(array);
+    }
+  }
+  return size;
+}
+
+fs::path series_path(const fs::path &data_folder) {
+  return data_folder / "Full.cosmo.vtp.series";
+}
+
+fs::path manifest_path(const fs::path &data_folder) {
+  return data_folder / "Full.cosmo.manifest";
+}
+
+/*
+  The .series file is JSON, a list of {"name": "./Full.cosmo.000.vtp",
+  "time": 0} objects. The times are the timesteps of the snapshots.
+*/
+std::map<int, fs::path> read_series(const fs::path &series) {
+  std::ifstream in(series);
+  if (!in) {
+    throw std::runtime_error("Unable to open " + series.string());
+  }
+  std::string text((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+
+  std::map<int, fs::path> files;
+  size_t pos = 0;
+  while ((pos = text.find("\"name\"", pos)) != std::string::npos) {
+    size_t open = text.find('"', text.find(':', pos));
+    size_t close = text.find('"', open + 1);
+    size_t time = text.find("\"time\"", close);
+    if (open == std::string::npos || close == std::string::npos ||
+        time == std::string::npos) {
+      throw std::runtime_error(series.string() + " is malformed");
+    }
+    std::string name = text.substr(open + 1, close - open - 1);
+    double value = strtod(text.c_str() + text.find(':', time) + 1, nullptr);
+
+    files.insert_or_assign(static_cast<int>(std::lround(value)),
+                           (series.parent_path() / name).lexically_normal());
+    pos = close;
+  }
+  return files;
+}
+
+Manifest build_manifest(const std::map<int, fs::path> &files) {
+  Manifest manifest;
+
+  for (const auto &file : files) {
+    VTPHeader header = read_vtp_header(file.second);
+
+    // The points and mask are decoded for the bounds and the number of
+    // baryons, arrays without ranges in the header for their range
+    ColumnSet columns{"mask"};
+    for (const VTPArrayHeader &array : header.pointArrays) {
+      if (std::isnan(array.range[0])) {
+        columns.insert(array.name);
+      }
+    }
+    vtkSmartPointer<vtkPolyData> snapshot =
+        load_snapshot(file.first, file.second, false, columns);
+    vtkPointData *pointData = snapshot->GetPointData();
+
+    SnapshotSummary summary;
+    summary.step = file.first;
+    summary.path = file.second;
+    summary.numPoints = header.numPoints;
+    snapshot->GetPoints()->GetBounds(summary.bounds);
+    summary.points = Summarize(header.points, snapshot->GetPoints()->GetData());
+    for (const VTPArrayHeader &array : header.pointArrays) {
+      summary.arrays.push_back(
+          Summarize(array, pointData->GetArray(array.name.c_str())));
+    }
+
+    summary.numBaryons = 0;
+    if (vtkDataArray *mask = pointData->GetArray("mask")) {
+      for (double value : vtk::DataArrayValueRange<1>(mask)) {
+        summary.numBaryons += (static_cast<int>(value) & 0b10) != 0;
+      }
+    }
+
+    printf("[Manifest]: Timestep %d, %lld points\n", file.first,
+           static_cast<long long>(summary.numPoints));
+    manifest.insert_or_assign(file.first, std::move(summary));
+  }
+
+  return manifest;
+}
+
+/*
+  A text file with a line per snapshot and one for its points and every
+  point array:
+    snapshot STEP POINTS BARYONS XMIN XMAX YMIN YMAX ZMIN ZMAX PATH
+    points TYPE COMPONENTS MIN MAX OFFSET
+    array TYPE COMPONENTS MIN MAX OFFSET NAME
+  Paths are relative to the manifest.
+*/
+void write_manifest(const Manifest &manifest, const fs::path &out_path) {
+  fs::path tmp_path(out_path);
+  tmp_path += ".tmp";
+
+  std::ofstream out(tmp_path, std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Unable to write " + tmp_path.string());
+  }
+  out.precision(std::numeric_limits<double>::max_digits10);
+  out << MANIFEST_MAGIC << '\n';
+
+  fs::path folder = out_path.parent_path();
+  for (const auto &entry : manifest) {
+    const SnapshotSummary &summary = entry.second;
+    out << "snapshot " << summary.step << ' ' << summary.numPoints << ' '
+        << summary.numBaryons;
+    for (double bound : summary.bounds) {
+      out << ' ' << bound;
+    }
+    out << ' ' << summary.path.lexically_relative(folder).string() << '\n';
+
+    WriteArray(out, "points", summary.points);
+    out << '\n';
+    for (const ArraySummary &array : summary.arrays) {
+      WriteArray(out, "array", array);
+      out << ' ' << array.name << '\n';
+    }
+  }
+  out.close();
+
+  if (!out) {
+    throw std::runtime_error("Failed writing " + tmp_path.string());
+  }
+  fs::rename(tmp_path, out_path);
+}
+
+Manifest load_manifest(const fs::path &path) {
+  std::ifstream in(path);
+  std::string line;
+  if (!in || !std::getline(in, line) || line != MANIFEST_MAGIC) {
+    throw std::runtime_error(path.string() + " is not a manifest");
+  }
+
+  Manifest manifest;
+  SnapshotSummary *current = nullptr;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string kind;
+    fields >> kind;
+
+    if (kind == "snapshot") {
+      SnapshotSummary summary;
+      summary.step = static_cast<int>(ReadInt(fields));
+      summary.numPoints = ReadInt(fields);
+      summary.numBaryons = ReadInt(fields);
+      for (double &bound : summary.bounds) {
+        bound = ReadDouble(fields);
+      }
+      summary.path = path.parent_path() / ReadRest(fields);
+      current = &(manifest[summary.step] = std::move(summary));
+    } else if (kind == "points" && current != nullptr) {
+      current->points = ReadArray(fields);
+      current->points.name = "Points";
+    } else if (kind == "array" && current != nullptr) {
+      ArraySummary array = ReadArray(fields);
+      array.name = ReadRest(fields);
+      current->arrays.push_back(array);
+    } else if (!kind.empty()) {
+      throw std::runtime_error(path.string() + " is malformed: " + line);
+    }
+  }
+  return manifest;
+}
+
+bool manifest_is_current(const Manifest &manifest,
+                         const fs::path &data_folder) {
+  std::error_code error;
+  auto written = fs::last_write_time(manifest_path(data_folder), error);
+  if (error) {
+    return false;
+  }
+
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder.string());
+  if (files.size() != manifest.size()) {
+    return false;
+  }
+  for (const auto &[step, path] : files) {
+    auto entry = manifest.find(step);
+    if (entry == manifest.end() ||
+        entry->second.path.filename() != path.filename()) {
+      return false;
+    }
+    auto modified = fs::last_write_time(path, error);
+    if (error || modified > written) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool series_range(const Manifest &manifest, const std::string &name,
+                  double range[2]) {
+  bool found = false;
+  for (const auto &entry : manifest) {
+    const ArraySummary *array = entry.second.FindArray(name);
+    if (array == nullptr || std::isnan(array->range[0])) {
+      continue;
+    }
+    range[0] = found ? std::min(range[0], array->range[0]) : array->range[0];
+    range[1] = found ? std::max(range[1], array->range[1]) : array->range[1];
+    found = true;
+  }
+  return found;
+}
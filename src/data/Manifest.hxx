@@ -0,0 +1,77 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Loader.h" // for ColumnSet
+
+namespace fs = std::filesystem;
+
+/*
+  Dataset manifest
+
+  What is known about every snapshot without decoding it: its file, the
+  number of points (and baryons), the bounds of the points and type, range
+  and file offset of every point array. It is built once (VisCosTool
+  manifest) from the .series file, the XML header of every snapshot and one
+  decode of its points and mask, and is stored next to the snapshots as a
+  text file.
+
+  VisCos reads it on startup instead of scanning the data folder, so the
+  timesteps, scalar ranges and snapshot sizes are known before the first
+  snapshot is loaded.
+*/
+
+struct ArraySummary {
+  std::string name;
+  int dataType;
+  int numComponents;
+  // Of the magnitude for arrays with several components
+  double range[2];
+  // Of the encoded array in the .vtp file
+  uint64_t offset;
+};
+
+struct SnapshotSummary {
+  int step;
+  fs::path path;
+  int64_t numPoints;
+  int64_t numBaryons;
+  double bounds[6];
+  ArraySummary points;
+  // The point arrays
+  std::vector<ArraySummary> arrays;
+
+  const ArraySummary *FindArray(const std::string &name) const;
+  // Bytes of the points and the given columns once decoded, all columns if
+  // it is empty. With float32 double columns count as floats.
+  size_t DecodedSize(const ColumnSet &columns = {},
+                     bool float32 = false) const;
+};
+
+using Manifest = std::map<int, SnapshotSummary>;
+
+fs::path series_path(const fs::path &data_folder);
+fs::path manifest_path(const fs::path &data_folder);
+
+// The snapshot files listed in a ParaView .series file by timestep
+std::map<int, fs::path> read_series(const fs::path &series);
+
+// Summarizes the given snapshots, see above
+Manifest build_manifest(const std::map<int, fs::path> &files);
+
+void write_manifest(const Manifest &manifest, const fs::path &out_path);
+Manifest load_manifest(const fs::path &path);
+
+// Whether the manifest (read from the folder) still lists the snapshots of
+// the folder (.series file or scan) and none of them was written after it
+bool manifest_is_current(const Manifest &manifest,
+                         const fs::path &data_folder);
+
+// Range of the array over all snapshots, false if no snapshot has it
+bool series_range(const Manifest &manifest, const std::string &name,
+                  double range[2]);
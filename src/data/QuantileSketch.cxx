@@ -0,0 +1,317 @@
+#include <algorithm> // for min, max, copy, equal
+#include <cmath>     // for log, pow, ceil, isnan, log10
+#include <cstring>   // for strncpy
+#include <filesystem>
+#include <fstream>
+#include <stdexcept> // for runtime_error
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <vtkArrayDispatch.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkType.h> // for vtkIdType
+
+#include "QuantileSketch.hxx"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Ratio of the bounds of a bin, the relative error is (GAMMA - 1) / 2
+const double GAMMA = 1.02;
+const double LOG_GAMMA = std::log(GAMMA);
+
+// Bin indices of |value| are clamped to MIN_INDEX..MAX_INDEX, which covers
+// 1e-40..1e40
+const int32_t MIN_INDEX = -4650;
+const int32_t MAX_INDEX = 4650;
+const int32_t NUM_KEYS = MAX_INDEX - MIN_INDEX + 1;
+
+const char SKETCHES_MAGIC[8] = {'V', 'C', 'S', 'K', 'T', '0', '1', '\0'};
+
+struct SketchesHeader {
+  char magic[8];
+  int64_t numSketches;
+};
+
+struct SketchHeader {
+  int32_t step;
+  uint32_t numBins;
+  char name[48];
+};
+
+struct SketchBin {
+  int32_t key;
+  uint32_t reserved;
+  int64_t count;
+};
+
+struct SketchWorker {
+  vtkSMPThreadLocal<QuantileSketch> *local;
+  double scale;
+
+  template <typename ArrayT> void operator()(ArrayT *array) {
+    auto add = [&](vtkIdType begin, vtkIdType end) {
+      QuantileSketch &sketch = local->Local();
+      for (auto value : vtk::DataArrayValueRange<1>(array, begin, end)) {
+        sketch.Add(scale * value);
+      }
+    };
+    vtkSMPTools::For(0, array->GetNumberOfTuples(), add);
+  }
+};
+
+} // namespace
+
+/*
+  The key orders the bins like their values: -NUM_KEYS..-1 for negative
+  values (the larger |value| the smaller), 0 for zero and 1..NUM_KEYS for
+  positive values.
+*/
+int32_t QuantileSketch::Key(double value) {
+  if (value == 0) {
+    return 0;
+  }
+  double index = std::ceil(std::log(std::abs(value)) / LOG_GAMMA);
+  int32_t clamped = static_cast<int32_t>(
+      std::min<double>(std::max<double>(index, MIN_INDEX), MAX_INDEX));
+  int32_t key = clamped - MIN_INDEX + 1;
+  return value > 0 ? key : -key;
+}
+
+// The value in the middle of the bin (of least relative error)
+double QuantileSketch::Value(int32_t key) {
+  if (key == 0) {
+    return 0;
+  }
+  int32_t index = std::abs(key) - 1 + MIN_INDEX;
+  double value = 2 * std::pow(GAMMA, index) / (GAMMA + 1);
+  return key > 0 ? value : -value;
+}
+
+/*
+  Grows the span by at least half of its size at once, so values which
+  slowly extend it do not move the bins every time.
+*/
+int64_t &QuantileSketch::Bin(int32_t key) {
+  if (bins.empty()) {
+    offset = key;
+    bins.assign(1, 0);
+  }
+  int32_t size = static_cast<int32_t>(bins.size());
+  int32_t slack = std::max(size / 2, 16);
+  if (key < offset) {
+    int32_t first = std::max(std::min(key, offset - slack), -NUM_KEYS);
+    bins.insert(bins.begin(), offset - first, 0);
+    offset = first;
+  } else if (key >= offset + size) {
+    int32_t last =
+        std::min(std::max(key, offset + size - 1 + slack), NUM_KEYS);
+    bins.resize(last - offset + 1, 0);
+  }
+  return bins[key - offset];
+}
+
+void QuantileSketch::Add(double value) {
+  if (std::isnan(value)) {
+    return;
+  }
+  Bin(Key(value))++;
+  count++;
+}
+
+void QuantileSketch::Merge(const QuantileSketch &other) {
+  if (other.bins.empty()) {
+    return;
+  }
+  int32_t last = other.offset + static_cast<int32_t>(other.bins.size()) - 1;
+  Bin(other.offset);
+  Bin(last);
+  for (size_t i = 0; i < other.bins.size(); i++) {
+    bins[other.offset - offset + i] += other.bins[i];
+  }
+  count += other.count;
+}
+
+double QuantileSketch::Quantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  q = std::min(std::max(q, 0.0), 1.0);
+  int64_t rank = static_cast<int64_t>(q * (count - 1));
+
+  int64_t seen = 0;
+  for (size_t i = 0; i < bins.size(); i++) {
+    seen += bins[i];
+    if (seen > rank) {
+      return Value(offset + static_cast<int32_t>(i));
+    }
+  }
+  return Value(offset + static_cast<int32_t>(bins.size()) - 1);
+}
+
+std::vector<std::pair<int32_t, int64_t>> QuantileSketch::GetBins() const {
+  std::vector<std::pair<int32_t, int64_t>> nonEmpty;
+  for (size_t i = 0; i < bins.size(); i++) {
+    if (bins[i] != 0) {
+      nonEmpty.emplace_back(offset + static_cast<int32_t>(i), bins[i]);
+    }
+  }
+  return nonEmpty;
+}
+
+void QuantileSketch::AddBin(int32_t key, int64_t n) {
+  if (key < -NUM_KEYS || key > NUM_KEYS || n < 0) {
+    throw std::runtime_error("Invalid sketch bin " + std::to_string(key));
+  }
+  Bin(key) += n;
+  count += n;
+}
+
+QuantileSketch sketch_array(vtkDataArray *array, double scale) {
+  vtkSMPThreadLocal<QuantileSketch> local;
+
+  SketchWorker worker{&local, scale};
+  using Dispatcher = vtkArrayDispatch::DispatchByValueType<
+      vtkArrayDispatch::Reals>;
+  if (!Dispatcher::Execute(array, worker)) {
+    worker(array);
+  }
+
+  QuantileSketch merged;
+  for (auto &sketch : local) {
+    merged.Merge(sketch);
+  }
+  return merged;
+}
+
+SnapshotSketches sketch_snapshot(vtkPolyData *snapshot,
+                                 double temperatureFactor) {
+  SnapshotSketches sketches;
+
+  vtkPointData *pointData = snapshot->GetPointData();
+  for (int i = 0; i < pointData->GetNumberOfArrays(); i++) {
+    vtkDataArray *array = pointData->GetArray(i);
+    if (array == nullptr || array->GetName() == nullptr ||
+        array->GetNumberOfComponents() != 1) {
+      continue;
+    }
+    int type = array->GetDataType();
+    if (type != VTK_FLOAT && type != VTK_DOUBLE) {
+      continue;
+    }
+    sketches[array->GetName()] = sketch_array(array);
+  }
+
+  vtkDataArray *uu = pointData->GetArray("uu");
+  if (uu != nullptr) {
+    sketches["Temperature"] = sketch_array(uu, temperatureFactor);
+  }
+  return sketches;
+}
+
+fs::path sketches_path(const fs::path &data_folder) {
+  return data_folder / "Full.cosmo.sketches";
+}
+
+SketchesWriter::SketchesWriter(const fs::path &out_path)
+    : outPath(out_path), tmpPath(out_path) {
+  tmpPath += ".tmp";
+  out.open(tmpPath, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Unable to write " + tmpPath.string());
+  }
+
+  // The number of sketches is only known on Close()
+  SketchesHeader header{};
+  std::copy(SKETCHES_MAGIC, SKETCHES_MAGIC + 8, header.magic);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void SketchesWriter::Write(int step, const SnapshotSketches &sketches) {
+  for (const auto &[name, sketch] : sketches) {
+    if (name.size() >= sizeof(SketchHeader::name)) {
+      throw std::runtime_error("Array name too long: " + name);
+    }
+    std::vector<SketchBin> bins;
+    for (const auto &[key, count] : sketch.GetBins()) {
+      bins.push_back({key, 0, count});
+    }
+
+    SketchHeader sketchHeader{};
+    sketchHeader.step = step;
+    sketchHeader.numBins = static_cast<uint32_t>(bins.size());
+    std::strncpy(sketchHeader.name, name.c_str(),
+                 sizeof(sketchHeader.name) - 1);
+    out.write(reinterpret_cast<const char *>(&sketchHeader),
+              sizeof(sketchHeader));
+    out.write(reinterpret_cast<const char *>(bins.data()),
+              bins.size() * sizeof(SketchBin));
+    numSketches++;
+  }
+}
+
+void SketchesWriter::Close() {
+  SketchesHeader header{};
+  std::copy(SKETCHES_MAGIC, SKETCHES_MAGIC + 8, header.magic);
+  header.numSketches = numSketches;
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.close();
+
+  if (!out) {
+    throw std::runtime_error("Failed writing " + tmpPath.string());
+  }
+  fs::rename(tmpPath, outPath);
+}
+
+SnapshotSketches load_merged_sketches(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Unable to open " + path.string());
+  }
+
+  SketchesHeader header;
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!in || !std::equal(SKETCHES_MAGIC, SKETCHES_MAGIC + 8, header.magic) ||
+      header.numSketches < 0) {
+    throw std::runtime_error(path.string() + " is not a sketches file");
+  }
+
+  SnapshotSketches merged;
+  std::vector<SketchBin> bins;
+  for (int64_t i = 0; i < header.numSketches; i++) {
+    SketchHeader sketchHeader;
+    in.read(reinterpret_cast<char *>(&sketchHeader), sizeof(sketchHeader));
+    bins.resize(in ? sketchHeader.numBins : 0);
+    in.read(reinterpret_cast<char *>(bins.data()),
+            bins.size() * sizeof(SketchBin));
+    if (!in) {
+      throw std::runtime_error(path.string() + " is truncated");
+    }
+
+    sketchHeader.name[sizeof(sketchHeader.name) - 1] = '\0';
+    QuantileSketch &sketch = merged[sketchHeader.name];
+    for (const SketchBin &bin : bins) {
+      sketch.AddBin(bin.key, bin.count);
+    }
+  }
+  return merged;
+}
+
+ColorRange color_range(const QuantileSketch &sketch, double low, double high) {
+  ColorRange color{{sketch.Quantile(low), sketch.Quantile(high)}, false};
+  if (color.range[0] >= color.range[1]) {
+    color.range[1] = color.range[0] + 1;
+  }
+  color.logScale = color.range[0] > 0 &&
+                   std::log10(color.range[1] / color.range[0]) > 3;
+  return color;
+}
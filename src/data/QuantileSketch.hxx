@@ -0,0 +1,95 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class vtkDataArray;
+class vtkPolyData;
+
+namespace fs = std::filesystem;
+
+/*
+  Mergeable quantile sketch of the values of an array
+
+  The values are counted in logarithmic bins (as in DDSketch): the positive
+  bin i holds the values in (GAMMA^(i-1), GAMMA^i], negative values are
+  mirrored and zeros have a bin of their own. Every quantile is known to a
+  relative error of about 1%, whatever the range of the values, and the
+  sketches of several snapshots merge by adding their counts. Only the span
+  of bins between the smallest and largest value is allocated.
+*/
+class QuantileSketch {
+public:
+  void Add(double value);
+  void Merge(const QuantileSketch &other);
+
+  // The value below which the fraction q of the values lie
+  double Quantile(double q) const;
+  int64_t GetCount() const { return count; }
+
+  // The non empty bins (key, count), ordered by value
+  std::vector<std::pair<int32_t, int64_t>> GetBins() const;
+  void AddBin(int32_t key, int64_t count);
+
+private:
+  // Counts of the keys offset..offset + bins.size() - 1, see Key()
+  int32_t offset = 0;
+  std::vector<int64_t> bins;
+  int64_t count = 0;
+
+  // The bin of the key, the span grows to include it
+  int64_t &Bin(int32_t key);
+
+  static int32_t Key(double value);
+  static double Value(int32_t key);
+};
+
+// Sketches of the arrays of a snapshot by name
+using SnapshotSketches = std::map<std::string, QuantileSketch>;
+
+// Sketches the values of a one component array, multiplied by scale, in
+// parallel
+QuantileSketch sketch_array(vtkDataArray *array, double scale = 1.0);
+
+// Sketches every floating point array of the snapshot with one component
+// and its "Temperature" (uu times temperatureFactor)
+SnapshotSketches sketch_snapshot(vtkPolyData *snapshot,
+                                 double temperatureFactor);
+
+// Sidecar file with the sketches of all snapshots of the data folder
+fs::path sketches_path(const fs::path &data_folder);
+
+// Writes the sketches of one snapshot after the other, so only the ones of
+// the current snapshot are in memory. The file replaces out_path on Close().
+class SketchesWriter {
+public:
+  explicit SketchesWriter(const fs::path &out_path);
+
+  void Write(int step, const SnapshotSketches &sketches);
+  void Close();
+
+private:
+  fs::path outPath;
+  fs::path tmpPath;
+  std::ofstream out;
+  int64_t numSketches = 0;
+};
+
+// The sketches of all snapshots of the file merged per array, merged while
+// reading
+SnapshotSketches load_merged_sketches(const fs::path &path);
+
+struct ColorRange {
+  double range[2];
+  bool logScale;
+};
+
+// The range between the low and high quantile of the sketch. It is
+// logarithmic if it is positive and spans more than three decades.
+ColorRange color_range(const QuantileSketch &sketch, double low = 0.01,
+                       double high = 0.99);
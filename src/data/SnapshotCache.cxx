@@ -0,0 +1,313 @@
+#include <algorithm> // for lower_bound, includes, set_difference
+#include <exception>
+#include <iterator> // for inserter
+#include <stdio.h>
+#include <utility>
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+
+#include "SnapshotCache.hxx"
+#include "SpatialIndex.hxx"
+
+namespace {
+
+// Whether a snapshot loaded with the columns have contains all of want
+bool Covers(const ColumnSet &have, const ColumnSet &want) {
+  if (have.empty()) {
+    return true;
+  }
+  if (want.empty()) {
+    return false;
+  }
+  return std::includes(have.begin(), have.end(), want.begin(), want.end());
+}
+
+} // namespace
+
+SnapshotCache::SnapshotCache(std::vector<int> steps, LoadFunction load,
+                             size_t budget, int numWorkers)
+    : steps(std::move(steps)), load(std::move(load)), budget(budget) {
+  std::sort(this->steps.begin(), this->steps.end());
+
+  for (int i = 0; i < numWorkers; i++) {
+    workers.emplace_back(&SnapshotCache::WorkerLoop, this);
+  }
+}
+
+SnapshotCache::~SnapshotCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    pending.clear();
+  }
+  workAvailable.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+vtkSmartPointer<vtkPolyData> SnapshotCache::Get(int step) {
+  std::unique_lock<std::mutex> lock(mutex);
+  pinned = step;
+
+  while (true) {
+    auto it = entries.find(step);
+    if (it != entries.end()) {
+      lru.splice(lru.begin(), lru, it->second.lruPosition);
+      if (!Covers(it->second.columns, columns)) {
+        return AddColumns(step, lock);
+      }
+      return it->second.data;
+    }
+
+    // A worker is already decoding it, wait for it instead of loading twice
+    if (loading.count(step)) {
+      loaded.wait(lock);
+      continue;
+    }
+    break;
+  }
+
+  loading.insert(step);
+  ColumnSet wanted = columns;
+  lock.unlock();
+
+  vtkSmartPointer<vtkPolyData> data;
+  try {
+    data = load(step, wanted);
+  } catch (...) {
+    lock.lock();
+    loading.erase(step);
+    loaded.notify_all();
+    throw;
+  }
+
+  lock.lock();
+  loading.erase(step);
+  Insert(step, data, wanted);
+  loaded.notify_all();
+
+  return data;
+}
+
+vtkSmartPointer<vtkPolyData>
+SnapshotCache::AddColumns(int step, std::unique_lock<std::mutex> &lock) {
+  vtkSmartPointer<vtkPolyData> cached = entries.at(step).data;
+  ColumnSet have = entries.at(step).columns;
+  ColumnSet missing;
+  if (!columns.empty()) {
+    std::set_difference(columns.begin(), columns.end(), have.begin(),
+                        have.end(), std::inserter(missing, missing.end()));
+  }
+  lock.unlock();
+
+  // The cached snapshot may be in use by other threads, so the columns are
+  // added to a copy which replaces it
+  vtkSmartPointer<vtkPolyData> extra = load(step, missing);
+  vtkSmartPointer<vtkPolyData> data = vtkSmartPointer<vtkPolyData>::New();
+  data->ShallowCopy(cached);
+  vtkPointData *pointData = extra->GetPointData();
+  for (int a = 0; a < pointData->GetNumberOfArrays(); a++) {
+    data->GetPointData()->AddArray(pointData->GetArray(a));
+  }
+
+  lock.lock();
+  auto it = entries.find(step);
+  if (it == entries.end() || it->second.data != cached) {
+    return data;
+  }
+  Entry &entry = it->second;
+  size_t indexBytes = entry.index ? entry.index->GetMemorySize() : 0;
+  usage -= entry.bytes;
+  entry.data = data;
+  entry.bytes =
+      static_cast<size_t>(data->GetActualMemorySize()) * 1024 + indexBytes;
+  usage += entry.bytes;
+  if (missing.empty()) {
+    entry.columns.clear();
+  } else {
+    entry.columns.insert(missing.begin(), missing.end());
+  }
+  Evict();
+
+  return data;
+}
+
+bool SnapshotCache::Contains(int step) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.count(step) > 0;
+}
+
+std::shared_ptr<const SpatialIndex> SnapshotCache::GetIndex(int step) {
+  vtkSmartPointer<vtkPolyData> data = Get(step);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(step);
+    if (it != entries.end() && it->second.index) {
+      return it->second.index;
+    }
+  }
+
+  // Built without holding the lock, if two threads race the first one wins
+  auto index = std::make_shared<const SpatialIndex>(
+      data, SpatialIndex::DefaultCellSize(data->GetNumberOfPoints()));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(step);
+  if (it == entries.end() || it->second.data != data) {
+    return index;
+  }
+  if (!it->second.index) {
+    it->second.index = index;
+    it->second.bytes += index->GetMemorySize();
+    usage += index->GetMemorySize();
+    Evict();
+  }
+  return it->second.index;
+}
+
+std::shared_ptr<const SpatialIndex> SnapshotCache::FindIndex(int step) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(step);
+  return it != entries.end() ? it->second.index : nullptr;
+}
+
+void SnapshotCache::Prefetch(int step, int direction) {
+  auto current = std::lower_bound(steps.begin(), steps.end(), step);
+  if (current == steps.end() || *current != step) {
+    return;
+  }
+  long index = current - steps.begin();
+  long count = static_cast<long>(steps.size());
+
+  // Nearest steps first. Without a direction we look both ways.
+  std::deque<int> targets;
+  for (int d = 1; d <= prefetchDistance; d++) {
+    if (direction >= 0 && index + d < count) {
+      targets.push_back(steps[index + d]);
+    }
+    if (direction <= 0 && index - d >= 0) {
+      targets.push_back(steps[index - d]);
+    }
+  }
+  // Keep the step we just came from around for jumping back
+  if (direction > 0 && index - 1 >= 0) {
+    targets.push_back(steps[index - 1]);
+  } else if (direction < 0 && index + 1 < count) {
+    targets.push_back(steps[index + 1]);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.clear();
+    for (int target : targets) {
+      if (!entries.count(target) && !loading.count(target)) {
+        pending.push_back(target);
+      }
+    }
+  }
+  workAvailable.notify_all();
+}
+
+void SnapshotCache::SetBudget(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  budget = bytes;
+  Evict();
+}
+
+size_t SnapshotCache::GetBudget() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return budget;
+}
+
+size_t SnapshotCache::GetMemoryUsage() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return usage;
+}
+
+void SnapshotCache::SetPrefetchDistance(int distance) {
+  std::lock_guard<std::mutex> lock(mutex);
+  prefetchDistance = std::max(distance, 0);
+}
+
+int SnapshotCache::GetPrefetchDistance() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return prefetchDistance;
+}
+
+void SnapshotCache::SetColumns(ColumnSet columns) {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->columns = std::move(columns);
+}
+
+ColumnSet SnapshotCache::GetColumns() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return columns;
+}
+
+void SnapshotCache::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    workAvailable.wait(lock, [this] { return stopping || !pending.empty(); });
+    if (stopping) {
+      return;
+    }
+
+    int step = pending.front();
+    pending.pop_front();
+    if (entries.count(step) || loading.count(step)) {
+      continue;
+    }
+
+    loading.insert(step);
+    ColumnSet wanted = columns;
+    lock.unlock();
+
+    vtkSmartPointer<vtkPolyData> data;
+    try {
+      data = load(step, wanted);
+    } catch (const std::exception &e) {
+      printf("[SnapshotCache]: Prefetching timestep %d failed: %s\n", step,
+             e.what());
+    }
+
+    lock.lock();
+    loading.erase(step);
+    if (data) {
+      Insert(step, data, wanted);
+    }
+    loaded.notify_all();
+  }
+}
+
+void SnapshotCache::Insert(int step, vtkSmartPointer<vtkPolyData> data,
+                           const ColumnSet &loadedColumns) {
+  // GetActualMemorySize() is in KiB
+  size_t bytes = static_cast<size_t>(data->GetActualMemorySize()) * 1024;
+
+  lru.push_front(step);
+  entries.insert_or_assign(step, Entry{data, bytes, lru.begin(), nullptr,
+                                       loadedColumns});
+  usage += bytes;
+
+  Evict();
+}
+
+void SnapshotCache::Evict() {
+  auto it = lru.end();
+  while (usage > budget && it != lru.begin()) {
+    --it;
+    if (*it == pinned) {
+      continue;
+    }
+
+    auto entry = entries.find(*it);
+    usage -= entry->second.bytes;
+    entries.erase(entry);
+    it = lru.erase(it);
+  }
+}
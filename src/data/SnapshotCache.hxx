@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+
+#include "Loader.h" // for ColumnSet
+
+class SpatialIndex;
+class vtkPolyData;
+
+/*
+  Keeps decoded snapshots in memory up to a byte budget and evicts the least
+  recently used ones. Neighbouring timesteps are decoded speculatively on
+  worker threads so that stepping forward/backward finds them ready.
+
+  Only the columns (point arrays) set by SetColumns() are loaded. When more
+  columns are needed later, Get() loads just the missing ones of a cached
+  snapshot and hands out a copy with them added.
+*/
+class SnapshotCache {
+public:
+  using LoadFunction = std::function<vtkSmartPointer<vtkPolyData>(
+      int step, const ColumnSet &columns)>;
+
+  // steps are all timesteps which can be loaded by load
+  SnapshotCache(std::vector<int> steps, LoadFunction load, size_t budget,
+                int numWorkers);
+  ~SnapshotCache();
+
+  // Returns the snapshot of the step, loads it on the calling thread if it is
+  // neither cached nor currently loaded by a worker.
+  vtkSmartPointer<vtkPolyData> Get(int step);
+  bool Contains(int step);
+
+  // The columns Get() returns from now on, empty for all. Cached snapshots
+  // keep the columns they have.
+  void SetColumns(ColumnSet columns);
+  ColumnSet GetColumns();
+
+  // The spatial index of the snapshot of the step. It is built on first use
+  // and kept (and evicted) together with the snapshot.
+  std::shared_ptr<const SpatialIndex> GetIndex(int step);
+  // The spatial index of the step if it was already built, nullptr
+  // otherwise. Neither loads nor builds anything.
+  std::shared_ptr<const SpatialIndex> FindIndex(int step);
+
+  // Schedules the prefetchDistance steps following step in the given
+  // direction (and the one step behind). Replaces all older prefetches
+  // which were not yet started.
+  void Prefetch(int step, int direction);
+
+  void SetBudget(size_t bytes);
+  size_t GetBudget();
+  size_t GetMemoryUsage();
+
+  void SetPrefetchDistance(int distance);
+  int GetPrefetchDistance();
+
+private:
+  struct Entry {
+    vtkSmartPointer<vtkPolyData> data;
+    size_t bytes;
+    std::list<int>::iterator lruPosition;
+    std::shared_ptr<const SpatialIndex> index;
+    // The columns it was loaded with
+    ColumnSet columns;
+  };
+
+  std::vector<int> steps;
+  LoadFunction load;
+  size_t budget;
+  size_t usage = 0;
+  int prefetchDistance = 2;
+  ColumnSet columns;
+
+  // The step returned by the last Get(), it is never evicted
+  int pinned = -1;
+
+  std::mutex mutex;
+  std::condition_variable workAvailable;
+  std::condition_variable loaded;
+  bool stopping = false;
+
+  std::map<int, Entry> entries;
+  std::list<int> lru; // most recently used first
+  std::set<int> loading;
+  std::deque<int> pending;
+  std::vector<std::thread> workers;
+
+  void WorkerLoop();
+  // Loads the columns the entry of step is missing, expects the lock to be
+  // held and releases it while loading
+  vtkSmartPointer<vtkPolyData> AddColumns(int step,
+                                          std::unique_lock<std::mutex> &lock);
+  // Both expect the mutex to be held
+  void Insert(int step, vtkSmartPointer<vtkPolyData> data,
+              const ColumnSet &loadedColumns);
+  void Evict();
+};
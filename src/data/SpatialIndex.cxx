@@ -0,0 +1,185 @@
+#include <algorithm> // for max, min
+#include <cmath>     // for cbrt, floor
+#include <limits>
+#include <stdexcept> // for runtime_error
+
+#include <vtkArrayDispatch.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+
+#include "SpatialIndex.hxx"
+
+namespace {
+
+/*
+  Sort key of every point: its cell in the upper and its index in the lower
+  32 bits, so sorting the keys sorts the points by cell (and by index within
+  a cell, which keeps the order deterministic).
+*/
+struct KeyWorker {
+  std::vector<uint64_t> *keys;
+  const double *origin;
+  const double *cellSize;
+  const int *dims;
+
+  template <typename ArrayT> void operator()(ArrayT *points) {
+    auto bin = [&](vtkIdType begin, vtkIdType end) {
+      const auto range = vtk::DataArrayTupleRange<3>(points, begin, end);
+      vtkIdType i = begin;
+      for (const auto p : range) {
+        uint64_t cell = 0;
+        for (int a = 2; a >= 0; a--) {
+          int c = static_cast<int>(std::floor((p[a] - origin[a]) / cellSize[a]));
+          // Points on (or slightly outside of) the upper faces
+          c = std::max(0, std::min(c, dims[a] - 1));
+          cell = cell * dims[a] + c;
+        }
+        (*keys)[i] = (cell << 32) | static_cast<uint64_t>(i);
+        i++;
+      }
+    };
+    vtkSMPTools::For(0, points->GetNumberOfTuples(), bin);
+  }
+};
+
+// Copies the points in cell order
+struct GatherWorker {
+  const std::vector<vtkIdType> *ids;
+  std::vector<float> *xyz;
+
+  template <typename ArrayT> void operator()(ArrayT *points) {
+    const auto range = vtk::DataArrayTupleRange<3>(points);
+    auto gather = [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType k = begin; k < end; k++) {
+        const auto p = range[(*ids)[k]];
+        for (int a = 0; a < 3; a++) {
+          (*xyz)[3 * k + a] = static_cast<float>(p[a]);
+        }
+      }
+    };
+    vtkSMPTools::For(0, static_cast<vtkIdType>(ids->size()), gather);
+  }
+};
+
+} // namespace
+
+SpatialIndex::SpatialIndex(vtkPolyData *points, double cellSize,
+                           double boxSize)
+    : periodic(boxSize > 0), box(boxSize) {
+  vtkIdType n = points->GetNumberOfPoints();
+  if (n >= (vtkIdType(1) << 32)) {
+    throw std::runtime_error("Too many points for the spatial index");
+  }
+
+  double extent[3];
+  double bounds[6];
+  if (!periodic) {
+    points->GetBounds(bounds);
+  }
+  for (int a = 0; a < 3; a++) {
+    if (periodic) {
+      origin[a] = 0;
+      extent[a] = box;
+    } else {
+      origin[a] = n > 0 ? bounds[2 * a] : 0;
+      extent[a] = std::max(n > 0 ? bounds[2 * a + 1] - bounds[2 * a] : 0.0,
+                           cellSize);
+    }
+  }
+
+  // At most about one cell per point, larger cells only make the queries
+  // look at more points
+  int maxDim = std::max(1, static_cast<int>(std::cbrt(static_cast<double>(n))));
+  for (int a = 0; a < 3; a++) {
+    dims[a] = static_cast<int>(std::floor(extent[a] / cellSize));
+    dims[a] = std::max(1, std::min(dims[a], maxDim));
+    this->cellSize[a] = extent[a] / dims[a];
+  }
+  vtkIdType numCells = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+
+  ids.resize(n);
+  xyz.resize(3 * n);
+  cellStart.assign(numCells + 1, n);
+  if (n == 0) {
+    return;
+  }
+
+  std::vector<uint64_t> keys(n);
+  vtkDataArray *data = points->GetPoints()->GetData();
+  KeyWorker binner{&keys, origin, this->cellSize, dims};
+  if (!vtkArrayDispatch::Dispatch::Execute(data, binner)) {
+    binner(data);
+  }
+  vtkSMPTools::Sort(keys.begin(), keys.end());
+
+  // Every cell in (previous key, key] starts at the first point of a run of
+  // equal keys, so each cell is written by exactly one thread
+  auto split = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType k = begin; k < end; k++) {
+      ids[k] = static_cast<vtkIdType>(keys[k] & 0xffffffffu);
+      vtkIdType cell = static_cast<vtkIdType>(keys[k] >> 32);
+      vtkIdType previous = k > 0 ? static_cast<vtkIdType>(keys[k - 1] >> 32) : -1;
+      for (vtkIdType c = previous + 1; c <= cell; c++) {
+        cellStart[c] = k;
+      }
+    }
+  };
+  vtkSMPTools::For(0, n, split);
+
+  GatherWorker gather{&ids, &xyz};
+  if (!vtkArrayDispatch::Dispatch::Execute(data, gather)) {
+    gather(data);
+  }
+}
+
+double SpatialIndex::DefaultCellSize(vtkIdType numPoints, double boxSize) {
+  const double pointsPerCell = 4;
+  return std::cbrt(boxSize * boxSize * boxSize * pointsPerCell /
+                   std::max<vtkIdType>(numPoints, 1));
+}
+
+size_t SpatialIndex::GetMemorySize() const {
+  return ids.size() * sizeof(vtkIdType) + xyz.size() * sizeof(float) +
+         cellStart.size() * sizeof(vtkIdType);
+}
+
+std::vector<vtkIdType> SpatialIndex::FindPointsInSphere(const double center[3],
+                                                        double radius) const {
+  std::vector<vtkIdType> found;
+  ForEachInSphere(center, radius, [&](vtkIdType id, const double *) {
+    found.push_back(id);
+    return true;
+  });
+  return found;
+}
+
+std::vector<vtkIdType> SpatialIndex::FindPointsInBox(const double lo[3],
+                                                     const double hi[3]) const {
+  std::vector<vtkIdType> found;
+  ForEachInBox(lo, hi, [&](vtkIdType id, const double *) {
+    found.push_back(id);
+    return true;
+  });
+  return found;
+}
+
+vtkIdType SpatialIndex::FindClosestPoint(const double p[3],
+                                         double maxRadius) const {
+  vtkIdType closest = -1;
+  double best = std::numeric_limits<double>::max();
+  ForEachInSphere(p, maxRadius, [&](vtkIdType id, const double *q) {
+    double d2 = 0;
+    for (int a = 0; a < 3; a++) {
+      d2 += (q[a] - p[a]) * (q[a] - p[a]);
+    }
+    if (d2 < best) {
+      best = d2;
+      closest = id;
+    }
+    return true;
+  });
+  return closest;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm> // for max, min
+#include <cmath>     // for floor
+#include <cstdint>
+#include <stddef.h>
+#include <vector>
+
+#include <vtkType.h> // for vtkIdType
+
+class vtkPolyData;
+
+/*
+  Cell list over the points of a snapshot: the (periodic) box is divided
+  into uniform cells and the points are sorted by their cell key, so the
+  points of a cell are contiguous. Built in parallel (keys, parallel sort)
+  once per snapshot and shared by all spatial queries (clustering, SPH,
+  region queries and picking) instead of scanning all points.
+
+  Queries call f(id, position) for every point found, where position is
+  the periodic image of the point closest to the query. They stop once f
+  returns false. Radii have to stay below half the box.
+*/
+class SpatialIndex {
+public:
+  // Cells are at least cellSize wide. boxSize is the edge of the periodic
+  // box starting at 0, with 0 the bounds of the points are used instead.
+  SpatialIndex(vtkPolyData *points, double cellSize, double boxSize = 64.0);
+
+  // Cells with a few points each on average
+  static double DefaultCellSize(vtkIdType numPoints, double boxSize = 64.0);
+
+  vtkIdType GetNumberOfPoints() const {
+    return static_cast<vtkIdType>(ids.size());
+  }
+  size_t GetMemorySize() const;
+
+  // The k-th point in cell order
+  vtkIdType GetId(vtkIdType k) const { return ids[k]; }
+  const float *GetPosition(vtkIdType k) const { return &xyz[3 * k]; }
+
+  template <typename Functor>
+  void ForEachInSphere(const double center[3], double radius, Functor f) const {
+    const double radius2 = radius * radius;
+    double lo[3] = {center[0] - radius, center[1] - radius, center[2] - radius};
+    double hi[3] = {center[0] + radius, center[1] + radius, center[2] + radius};
+    ForEachCell(lo, hi, [&](vtkIdType begin, vtkIdType end, const double shift[3]) {
+      for (vtkIdType k = begin; k < end; k++) {
+        double q[3];
+        double d2 = 0;
+        for (int a = 0; a < 3; a++) {
+          q[a] = xyz[3 * k + a] + shift[a];
+          d2 += (q[a] - center[a]) * (q[a] - center[a]);
+        }
+        if (d2 <= radius2 && !f(ids[k], q)) {
+          return false;
+        }
+      }
+      return true;
+    });
+  }
+
+  // The axis aligned box [lo, hi]
+  template <typename Functor>
+  void ForEachInBox(const double lo[3], const double hi[3], Functor f) const {
+    ForEachCell(lo, hi, [&](vtkIdType begin, vtkIdType end, const double shift[3]) {
+      for (vtkIdType k = begin; k < end; k++) {
+        double q[3];
+        bool inside = true;
+        for (int a = 0; a < 3; a++) {
+          q[a] = xyz[3 * k + a] + shift[a];
+          inside = inside && q[a] >= lo[a] && q[a] <= hi[a];
+        }
+        if (inside && !f(ids[k], q)) {
+          return false;
+        }
+      }
+      return true;
+    });
+  }
+
+  std::vector<vtkIdType> FindPointsInSphere(const double center[3],
+                                            double radius) const;
+  std::vector<vtkIdType> FindPointsInBox(const double lo[3],
+                                         const double hi[3]) const;
+
+  // The point closest to p within maxRadius, -1 if there is none
+  vtkIdType FindClosestPoint(const double p[3], double maxRadius) const;
+
+private:
+  bool periodic;
+  double box;
+  double origin[3];
+  double cellSize[3];
+  int dims[3];
+
+  // Points sorted by cell: the original ids and their positions
+  std::vector<vtkIdType> ids;
+  std::vector<float> xyz;
+  // The points of cell c are [cellStart[c], cellStart[c + 1])
+  std::vector<vtkIdType> cellStart;
+
+  /*
+    Calls f(begin, end, shift) for the points of every cell overlapping
+    [lo, hi], shift moves them to the periodic image next to the query.
+    Stops once f returns false.
+  */
+  template <typename Functor>
+  void ForEachCell(const double lo[3], const double hi[3], Functor f) const {
+    int first[3];
+    int last[3];
+    for (int a = 0; a < 3; a++) {
+      first[a] = static_cast<int>(std::floor((lo[a] - origin[a]) / cellSize[a]));
+      last[a] = static_cast<int>(std::floor((hi[a] - origin[a]) / cellSize[a]));
+      if (periodic) {
+        // Every cell once
+        last[a] = std::min(last[a], first[a] + dims[a] - 1);
+      } else {
+        first[a] = std::max(first[a], 0);
+        last[a] = std::min(last[a], dims[a] - 1);
+      }
+    }
+
+    for (int z = first[2]; z <= last[2]; z++) {
+      for (int y = first[1]; y <= last[1]; y++) {
+        for (int x = first[0]; x <= last[0]; x++) {
+          int c[3] = {x, y, z};
+          double shift[3] = {0, 0, 0};
+          for (int a = 0; a < 3; a++) {
+            int wrapped = ((c[a] % dims[a]) + dims[a]) % dims[a];
+            shift[a] = static_cast<double>(c[a] - wrapped) / dims[a] * box;
+            c[a] = wrapped;
+          }
+          vtkIdType cell =
+              (static_cast<vtkIdType>(c[2]) * dims[1] + c[1]) * dims[0] + c[0];
+          if (cellStart[cell] < cellStart[cell + 1] &&
+              !f(cellStart[cell], cellStart[cell + 1], shift)) {
+            return;
+          }
+        }
+      }
+    }
+  }
+};
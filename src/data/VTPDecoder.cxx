@@ -0,0 +1,641 @@
+#include <algorithm> // for copy, min
+#include <atomic>
+#include <cmath> // for nan
+#include <cstring> // for memcpy, strcmp
+#include <fstream>
+#include <stdexcept> // for runtime_error
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, madvise, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+
+#include <vtkAbstractArray.h>
+#include <vtkBase64InputStream.h>
+#include <vtkByteSwap.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDataCompressor.h>
+#include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkLZ4DataCompressor.h>
+#include <vtkLZMADataCompressor.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLDataParser.h>
+#include <vtkZLibDataCompressor.h>
+
+#include "VTPDecoder.hxx"
+
+namespace {
+
+// Uncompressed arrays are copied in chunks of this many bytes. It is a
+// multiple of 3 so that base64 chunks start on whole quads.
+const size_t CHUNK_SIZE = 3 * 1024 * 1024;
+
+// The file mapped read only, unmapped when it goes out of scope
+class MappedFile {
+public:
+  explicit MappedFile(const fs::path &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Unable to open " + path.string());
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::runtime_error("Unable to stat " + path.string());
+    }
+    size = static_cast<size_t>(st.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Unable to map " + path.string());
+    }
+    // All blocks are read at once, start reading ahead of them
+    madvise(mapping, size, MADV_WILLNEED);
+    data = static_cast<const char *>(mapping);
+  }
+  ~MappedFile() { munmap(const_cast<char *>(data), size); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data;
+  size_t size;
+};
+
+// Values of the base64 characters, 0xff for all others
+struct Base64Table {
+  unsigned char values[256];
+
+  Base64Table() {
+    std::fill(values, values + 256, 0xff);
+    const char *alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (unsigned char i = 0; i < 64; i++) {
+      values[static_cast<unsigned char>(alphabet[i])] = i;
+    }
+  }
+};
+const Base64Table base64Table;
+
+/*
+  Decodes the bytes [first, first + count) of the base64 stream starting at
+  encoded. Every 3 bytes are 4 characters, so any range can be decoded
+  without the bytes before it. Returns false on invalid characters.
+*/
+bool DecodeBase64(const char *encoded, size_t first, size_t count,
+                  unsigned char *out) {
+  const unsigned char *in =
+      reinterpret_cast<const unsigned char *>(encoded) + first / 3 * 4;
+  size_t skip = first % 3;
+  const unsigned char *values = base64Table.values;
+
+  while (count > 0) {
+    // '=' pads the last quad of a stream
+    size_t valid = in[2] == '=' ? 1 : in[3] == '=' ? 2 : 3;
+    unsigned char a = values[in[0]];
+    unsigned char b = values[in[1]];
+    unsigned char c = valid > 1 ? values[in[2]] : 0;
+    unsigned char d = valid > 2 ? values[in[3]] : 0;
+    if (((a | b | c | d) & 0xc0) != 0 || valid <= skip) {
+      return false;
+    }
+
+    unsigned char triplet[3] = {
+        static_cast<unsigned char>(a << 2 | b >> 4),
+        static_cast<unsigned char>(b << 4 | c >> 2),
+        static_cast<unsigned char>(c << 6 | d)};
+    size_t n = std::min(valid - skip, count);
+    std::memcpy(out, triplet + skip, n);
+
+    out += n;
+    count -= n;
+    skip = 0;
+    in += 4;
+  }
+  return true;
+}
+
+vtkSmartPointer<vtkDataCompressor> CreateCompressor(const std::string &name) {
+  if (name == "vtkZLibDataCompressor") {
+    return vtkSmartPointer<vtkZLibDataCompressor>::New();
+  }
+  if (name == "vtkLZ4DataCompressor") {
+    return vtkSmartPointer<vtkLZ4DataCompressor>::New();
+  }
+  if (name == "vtkLZMADataCompressor") {
+    return vtkSmartPointer<vtkLZMADataCompressor>::New();
+  }
+  return nullptr;
+}
+
+/*
+  Collects the appended arrays to read, allocates them and splits their
+  data into tasks: one per compressed block, or chunks of uncompressed
+  arrays. Run() then executes all tasks at once.
+*/
+class Decoder {
+public:
+  Decoder(const MappedFile &file, vtkXMLDataParser *parser,
+          vtkXMLDataElement *root)
+      : file(file) {
+    appended = static_cast<size_t>(parser->GetAppendedDataPosition());
+    if (appended == 0 || appended > file.size) {
+      throw std::runtime_error("no appended data");
+    }
+    base64 = vtkBase64InputStream::SafeDownCast(parser->GetDataStream()) !=
+             nullptr;
+
+    const char *headerType = root->GetAttribute("header_type");
+    if (headerType == nullptr || strcmp(headerType, "UInt32") == 0) {
+      headerSize = 4;
+    } else if (strcmp(headerType, "UInt64") == 0) {
+      headerSize = 8;
+    } else {
+      throw std::runtime_error("unsupported header type " +
+                               std::string(headerType));
+    }
+
+    const uint16_t probe = 1;
+    bool bigEndian = *reinterpret_cast<const unsigned char *>(&probe) == 0;
+    const char *byteOrder = root->GetAttribute("byte_order");
+    swap = byteOrder != nullptr &&
+           strcmp(byteOrder, bigEndian ? "LittleEndian" : "BigEndian") == 0;
+
+    if (const char *name = root->GetAttribute("compressor")) {
+      compressor = name;
+      if (CreateCompressor(compressor) == nullptr) {
+        throw std::runtime_error("unsupported compressor " + compressor);
+      }
+    }
+  }
+
+  // Creates the array of the DataArray element and schedules its data. The
+  // number of tuples is checked against numTuples unless it is negative.
+  vtkSmartPointer<vtkDataArray> Add(vtkXMLDataElement *element,
+                                    vtkIdType numTuples) {
+    const char *format = element->GetAttribute("format");
+    if (format == nullptr || strcmp(format, "appended") != 0) {
+      throw std::runtime_error("only appended arrays are supported");
+    }
+    int dataType;
+    vtkTypeInt64 offset;
+    if (!element->GetWordTypeAttribute("type", dataType) ||
+        !element->GetScalarAttribute("offset", offset) || offset < 0) {
+      throw std::runtime_error("array without type or offset");
+    }
+
+    // Created like vtkXMLReader::CreateArray() does
+    vtkSmartPointer<vtkAbstractArray> created =
+        vtkSmartPointer<vtkAbstractArray>::Take(
+            vtkAbstractArray::CreateArray(dataType));
+    vtkSmartPointer<vtkDataArray> array = vtkDataArray::SafeDownCast(created);
+    if (array == nullptr) {
+      throw std::runtime_error("only numeric arrays are supported");
+    }
+    const char *name = element->GetAttribute("Name");
+    array->SetName(name);
+    int components = 1;
+    element->GetScalarAttribute("NumberOfComponents", components);
+    array->SetNumberOfComponents(components);
+    for (int c = 0; c < components; c++) {
+      std::string key = "ComponentName" + std::to_string(c);
+      if (const char *componentName = element->GetAttribute(key.c_str())) {
+        array->SetComponentName(c, componentName);
+      }
+    }
+
+    size_t start = appended + static_cast<size_t>(offset);
+    std::vector<Task> blocks;
+    size_t bytes = compressor.empty() ? PlanUncompressed(start, blocks)
+                                      : PlanCompressed(start, blocks);
+
+    size_t tupleSize = components * array->GetDataTypeSize();
+    if (tupleSize == 0 || bytes % tupleSize != 0 ||
+        (numTuples >= 0 && bytes / tupleSize != static_cast<size_t>(numTuples))) {
+      throw std::runtime_error("size of array " +
+                               std::string(name ? name : "") +
+                               " does not match");
+    }
+    array->SetNumberOfTuples(static_cast<vtkIdType>(bytes / tupleSize));
+
+    unsigned char *out = static_cast<unsigned char *>(array->GetVoidPointer(0));
+    for (Task &block : blocks) {
+      block.out = out + block.outOffset;
+      tasks.push_back(block);
+    }
+    if (swap) {
+      arrays.push_back(array);
+    }
+    return array;
+  }
+
+  // Decodes all added arrays
+  void Run() {
+    std::atomic<bool> failed(false);
+    vtkSMPThreadLocal<std::vector<unsigned char>> scratch;
+    vtkSMPThreadLocal<vtkSmartPointer<vtkDataCompressor>> compressors;
+
+    auto decode = [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType t = begin; t < end; t++) {
+        const Task &task = tasks[t];
+        const char *stream = file.data + task.start;
+
+        if (!task.compressed) {
+          if (base64) {
+            if (!DecodeBase64(stream, task.first, task.count, task.out)) {
+              failed = true;
+            }
+          } else {
+            std::memcpy(task.out, stream + task.first, task.count);
+          }
+          continue;
+        }
+
+        const unsigned char *compressed =
+            reinterpret_cast<const unsigned char *>(stream + task.first);
+        if (base64) {
+          std::vector<unsigned char> &buffer = scratch.Local();
+          buffer.resize(task.count);
+          if (!DecodeBase64(stream, task.first, task.count, buffer.data())) {
+            failed = true;
+            continue;
+          }
+          compressed = buffer.data();
+        }
+
+        vtkSmartPointer<vtkDataCompressor> &decompressor = compressors.Local();
+        if (decompressor == nullptr) {
+          decompressor = CreateCompressor(compressor);
+        }
+        if (decompressor->Uncompress(compressed, task.count, task.out,
+                                     task.size) != task.size) {
+          failed = true;
+        }
+      }
+    };
+    vtkSMPTools::For(0, static_cast<vtkIdType>(tasks.size()), 1, decode);
+
+    if (failed) {
+      throw std::runtime_error("corrupt appended data");
+    }
+
+    for (vtkDataArray *array : arrays) {
+      int wordSize = array->GetDataTypeSize();
+      unsigned char *data = static_cast<unsigned char *>(array->GetVoidPointer(0));
+      auto swapWords = [&](vtkIdType begin, vtkIdType end) {
+        vtkByteSwap::SwapVoidRange(data + begin * wordSize, end - begin,
+                                   wordSize);
+      };
+      vtkSMPTools::For(0, array->GetNumberOfValues(), swapWords);
+    }
+  }
+
+private:
+  // Decoded bytes [first, first + count) of the stream at start (a file
+  // offset), inflated to size bytes if compressed. They go to outOffset in
+  // the array, out is set once it is allocated.
+  struct Task {
+    size_t start;
+    size_t first;
+    size_t count;
+    size_t outOffset;
+    size_t size;
+    bool compressed;
+    unsigned char *out;
+  };
+
+  const MappedFile &file;
+  size_t appended;
+  bool base64;
+  bool swap;
+  size_t headerSize;
+  std::string compressor;
+
+  std::vector<Task> tasks;
+  std::vector<vtkSmartPointer<vtkDataArray>> arrays; // to byte swap
+
+  // Bytes in the file which encode the first decoded bytes of a stream
+  size_t Encoded(size_t decoded) const {
+    return base64 ? (decoded + 2) / 3 * 4 : decoded;
+  }
+
+  // Copies the first count decoded bytes of the stream at start
+  void ReadHeader(size_t start, size_t count, unsigned char *out) const {
+    if (start + Encoded(count) > file.size) {
+      throw std::runtime_error("truncated appended data");
+    }
+    if (base64) {
+      if (!DecodeBase64(file.data + start, 0, count, out)) {
+        throw std::runtime_error("corrupt appended data");
+      }
+    } else {
+      std::memcpy(out, file.data + start, count);
+    }
+  }
+
+  uint64_t HeaderWord(const unsigned char *header, size_t index) const {
+    if (headerSize == 4) {
+      uint32_t word;
+      std::memcpy(&word, header + index * 4, 4);
+      if (swap) {
+        vtkByteSwap::SwapVoidRange(&word, 1, 4);
+      }
+      return word;
+    }
+    uint64_t word;
+    std::memcpy(&word, header + index * 8, 8);
+    if (swap) {
+      vtkByteSwap::SwapVoidRange(&word, 1, 8);
+    }
+    return word;
+  }
+
+  // The stream is the byte count followed by the data, returns the count
+  size_t PlanUncompressed(size_t start, std::vector<Task> &blocks) {
+    unsigned char header[8];
+    ReadHeader(start, headerSize, header);
+    size_t bytes = HeaderWord(header, 0);
+    if (start + Encoded(headerSize + bytes) > file.size) {
+      throw std::runtime_error("truncated appended data");
+    }
+
+    for (size_t chunk = 0; chunk < bytes; chunk += CHUNK_SIZE) {
+      size_t count = std::min(CHUNK_SIZE, bytes - chunk);
+      blocks.push_back(
+          Task{start, headerSize + chunk, count, chunk, count, false, nullptr});
+    }
+    return bytes;
+  }
+
+  /*
+    The header holds the number of blocks, the size of a block, the size of
+    the last one (0 if it is full) and the compressed size of every block.
+    It is encoded on its own, the compressed blocks follow as one stream.
+    Returns the size of the inflated array.
+  */
+  size_t PlanCompressed(size_t start, std::vector<Task> &blocks) {
+    unsigned char head[24];
+    ReadHeader(start, 3 * headerSize, head);
+    size_t numBlocks = HeaderWord(head, 0);
+    size_t blockSize = HeaderWord(head, 1);
+    size_t lastSize = HeaderWord(head, 2);
+    if (numBlocks > file.size) {
+      throw std::runtime_error("corrupt compression header");
+    }
+
+    std::vector<unsigned char> header((3 + numBlocks) * headerSize);
+    ReadHeader(start, header.size(), header.data());
+
+    size_t data = start + Encoded(header.size());
+    size_t compressedOffset = 0;
+    size_t bytes = 0;
+    for (size_t b = 0; b < numBlocks; b++) {
+      size_t compressedSize = HeaderWord(header.data(), 3 + b);
+      size_t size = b + 1 == numBlocks && lastSize != 0 ? lastSize : blockSize;
+      blocks.push_back(Task{data, compressedOffset, compressedSize, bytes, size,
+                            true, nullptr});
+      compressedOffset += compressedSize;
+      bytes += size;
+    }
+    if (data + Encoded(compressedOffset) > file.size) {
+      throw std::runtime_error("truncated appended data");
+    }
+    return bytes;
+  }
+};
+
+// The DataArray elements directly below element
+std::vector<vtkXMLDataElement *> DataArrays(vtkXMLDataElement *element) {
+  std::vector<vtkXMLDataElement *> arrays;
+  for (int i = 0; element && i < element->GetNumberOfNestedElements(); i++) {
+    vtkXMLDataElement *nested = element->GetNestedElement(i);
+    if (strcmp(nested->GetName(), "DataArray") == 0) {
+      arrays.push_back(nested);
+    }
+  }
+  return arrays;
+}
+
+// Marks the arrays named by the attributes of the element (e.g.
+// Scalars="rho") active
+void SetActiveAttributes(vtkXMLDataElement *element,
+                         vtkDataSetAttributes *attributes) {
+  for (int a = 0; element && a < vtkDataSetAttributes::NUM_ATTRIBUTES; a++) {
+    const char *name = element->GetAttribute(
+        vtkDataSetAttributes::GetAttributeTypeAsString(a));
+    if (name != nullptr && attributes->GetAbstractArray(name) != nullptr) {
+      attributes->SetActiveAttribute(name, a);
+    }
+  }
+}
+
+// The legacy cell layout stores the end offset of every cell
+vtkSmartPointer<vtkCellArray> BuildCells(vtkDataArray *connectivity,
+                                         vtkDataArray *ends) {
+  vtkNew<vtkIdTypeArray> ids;
+  ids->DeepCopy(connectivity);
+  vtkNew<vtkIdTypeArray> endIds;
+  endIds->DeepCopy(ends);
+
+  vtkNew<vtkIdTypeArray> offsets;
+  offsets->SetNumberOfValues(endIds->GetNumberOfValues() + 1);
+  offsets->SetValue(0, 0);
+  std::copy(endIds->GetPointer(0),
+            endIds->GetPointer(0) + endIds->GetNumberOfValues(),
+            offsets->GetPointer(1));
+
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  cells->SetData(offsets, ids);
+  return cells;
+}
+
+// Parses the XML in front of the appended data, returns the only piece
+vtkXMLDataElement *ParseHeader(const fs::path &path,
+                               vtkXMLDataParser *parser) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  if (!stream) {
+    throw std::runtime_error("Unable to open " + path.string());
+  }
+  parser->SetStream(&stream);
+  int parsed = parser->Parse();
+  parser->SetStream(nullptr);
+  if (!parsed) {
+    throw std::runtime_error("Unable to parse " + path.string());
+  }
+
+  vtkXMLDataElement *root = parser->GetRootElement();
+  if (root == nullptr || strcmp(root->GetName(), "VTKFile") != 0 ||
+      root->GetAttribute("type") == nullptr ||
+      strcmp(root->GetAttribute("type"), "PolyData") != 0) {
+    throw std::runtime_error(path.string() + " is not a VTK PolyData file");
+  }
+  vtkXMLDataElement *polyData = root->FindNestedElementWithName("PolyData");
+  int numPieces = 0;
+  for (int i = 0; polyData && i < polyData->GetNumberOfNestedElements(); i++) {
+    numPieces += strcmp(polyData->GetNestedElement(i)->GetName(), "Piece") == 0;
+  }
+  if (numPieces != 1) {
+    throw std::runtime_error("only files with one piece are supported");
+  }
+  return polyData->FindNestedElementWithName("Piece");
+}
+
+VTPArrayHeader ArrayHeader(vtkXMLDataElement *element, size_t appended) {
+  VTPArrayHeader header;
+  const char *name = element->GetAttribute("Name");
+  header.name = name ? name : "";
+  if (!element->GetWordTypeAttribute("type", header.dataType)) {
+    throw std::runtime_error("array " + header.name + " without type");
+  }
+  header.numComponents = 1;
+  element->GetScalarAttribute("NumberOfComponents", header.numComponents);
+  if (!element->GetScalarAttribute("RangeMin", header.range[0]) ||
+      !element->GetScalarAttribute("RangeMax", header.range[1])) {
+    header.range[0] = header.range[1] = std::nan("");
+  }
+  vtkTypeInt64 offset = 0;
+  element->GetScalarAttribute("offset", offset);
+  header.offset = appended + static_cast<uint64_t>(offset);
+  return header;
+}
+
+} // namespace
+
+VTPHeader read_vtp_header(const fs::path &path) {
+  vtkNew<vtkXMLDataParser> parser;
+  vtkXMLDataElement *piece = ParseHeader(path, parser);
+  size_t appended = static_cast<size_t>(parser->GetAppendedDataPosition());
+
+  VTPHeader header;
+  header.numPoints = 0;
+  piece->GetScalarAttribute("NumberOfPoints", header.numPoints);
+  std::vector<vtkXMLDataElement *> points =
+      DataArrays(piece->FindNestedElementWithName("Points"));
+  if (points.empty()) {
+    throw std::runtime_error(path.string() + " has no points");
+  }
+  header.points = ArrayHeader(points.front(), appended);
+  for (vtkXMLDataElement *element :
+       DataArrays(piece->FindNestedElementWithName("PointData"))) {
+    header.pointArrays.push_back(ArrayHeader(element, appended));
+  }
+  return header;
+}
+
+vtkSmartPointer<vtkPolyData> read_vtp_parallel(const fs::path &path,
+                                               const ColumnSet &columns) {
+  vtkNew<vtkXMLDataParser> parser;
+  vtkXMLDataElement *piece = ParseHeader(path, parser);
+  vtkXMLDataElement *root = parser->GetRootElement();
+  vtkXMLDataElement *polyData = root->FindNestedElementWithName("PolyData");
+
+  MappedFile file(path);
+  Decoder decoder(file, parser, root);
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+
+  vtkIdType numPoints = 0;
+  piece->GetScalarAttribute("NumberOfPoints", numPoints);
+  std::vector<vtkXMLDataElement *> points =
+      DataArrays(piece->FindNestedElementWithName("Points"));
+  if (!points.empty()) {
+    vtkNew<vtkPoints> outPoints;
+    outPoints->SetData(decoder.Add(points.front(), numPoints));
+    output->SetPoints(outPoints);
+  }
+
+  vtkXMLDataElement *pointData = piece->FindNestedElementWithName("PointData");
+  for (vtkXMLDataElement *element : DataArrays(pointData)) {
+    const char *name = element->GetAttribute("Name");
+    if (!columns.empty() && (name == nullptr || !columns.count(name))) {
+      continue;
+    }
+    output->GetPointData()->AddArray(decoder.Add(element, numPoints));
+  }
+  SetActiveAttributes(pointData, output->GetPointData());
+
+  // Cells, decoded together with the points
+  const char *cellTypes[4] = {"Verts", "Lines", "Strips", "Polys"};
+  vtkSmartPointer<vtkDataArray> connectivity[4];
+  vtkSmartPointer<vtkDataArray> ends[4];
+  vtkIdType numCells = 0;
+  for (int c = 0; c < 4; c++) {
+    vtkIdType count = 0;
+    piece->GetScalarAttribute(("NumberOf" + std::string(cellTypes[c])).c_str(),
+                              count);
+    vtkXMLDataElement *element = piece->FindNestedElementWithName(cellTypes[c]);
+    if (count <= 0 || element == nullptr) {
+      continue;
+    }
+    vtkXMLDataElement *conn = element->FindNestedElementWithNameAndAttribute(
+        "DataArray", "Name", "connectivity");
+    vtkXMLDataElement *offs = element->FindNestedElementWithNameAndAttribute(
+        "DataArray", "Name", "offsets");
+    if (conn == nullptr || offs == nullptr) {
+      throw std::runtime_error(std::string(cellTypes[c]) +
+                               " without connectivity or offsets");
+    }
+    connectivity[c] = decoder.Add(conn, -1);
+    ends[c] = decoder.Add(offs, count);
+    numCells += count;
+  }
+
+  vtkXMLDataElement *cellData = piece->FindNestedElementWithName("CellData");
+  for (vtkXMLDataElement *element : DataArrays(cellData)) {
+    output->GetCellData()->AddArray(decoder.Add(element, numCells));
+  }
+  SetActiveAttributes(cellData, output->GetCellData());
+
+  for (vtkXMLDataElement *element :
+       DataArrays(polyData->FindNestedElementWithName("FieldData"))) {
+    vtkIdType numTuples = -1;
+    element->GetScalarAttribute("NumberOfTuples", numTuples);
+    output->GetFieldData()->AddArray(decoder.Add(element, numTuples));
+  }
+
+  decoder.Run();
+
+  for (int c = 0; c < 4; c++) {
+    if (connectivity[c] == nullptr) {
+      continue;
+    }
+    vtkSmartPointer<vtkCellArray> cells = BuildCells(connectivity[c], ends[c]);
+    switch (c) {
+    case 0:
+      output->SetVerts(cells);
+      break;
+    case 1:
+      output->SetLines(cells);
+      break;
+    case 2:
+      output->SetStrips(cells);
+      break;
+    default:
+      output->SetPolys(cells);
+      break;
+    }
+  }
+
+  // The stock reader reports the time of the TimeValue field array
+  vtkDataArray *time = output->GetFieldData()->GetArray("TimeValue");
+  if (time != nullptr && time->GetNumberOfTuples() > 0) {
+    output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(),
+                                  time->GetTuple1(0));
+  }
+
+  return output;
+}
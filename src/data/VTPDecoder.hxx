@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkType.h> // for vtkIdType
+
+#include "Loader.h" // for ColumnSet
+
+class vtkPolyData;
+
+namespace fs = std::filesystem;
+
+/*
+  Parallel reader for .vtp files with appended data
+
+  vtkXMLPolyDataReader decodes and inflates the arrays one after the other on
+  a single thread, although appended arrays are stored as independently
+  compressed blocks. Here the XML header is parsed once (by
+  vtkXMLDataParser), the file is mapped into memory and every block of every
+  array is decoded (base64) and inflated concurrently with vtkSMPTools,
+  straight into its place in the preallocated arrays.
+
+  The output matches the one of vtkXMLPolyDataReader: the same points, cells,
+  point and field arrays (types, names, components) and active attributes.
+  Of the point arrays only the ones in columns are decoded, all if it is
+  empty.
+
+  Files with inline or ascii arrays, several pieces or an unknown compressor
+  raise a std::runtime_error, load_snapshot() then uses the stock reader.
+*/
+vtkSmartPointer<vtkPolyData> read_vtp_parallel(const fs::path &path,
+                                               const ColumnSet &columns = {});
+
+// An array as the XML header of a .vtp file describes it
+struct VTPArrayHeader {
+  std::string name;
+  int dataType;
+  int numComponents;
+  // RangeMin and RangeMax as written by vtkXMLWriter (of the magnitude for
+  // several components), NaN if the file has none
+  double range[2];
+  // Of the encoded array in the file
+  uint64_t offset;
+};
+
+struct VTPHeader {
+  vtkIdType numPoints;
+  VTPArrayHeader points;
+  std::vector<VTPArrayHeader> pointArrays;
+};
+
+// Parses only the XML header of the file, nothing is decoded
+VTPHeader read_vtp_header(const fs::path &path);
@@ -1,11 +1,6 @@
-#include <assert.h>
-
 #include <vtkLookupTable.h>
 #include <vtkNew.h>
 #include <vtkColorTransferFunction.h>
-#include <vtkStructuredGrid.h>
-#include <vtkPoints.h>
-#include <vtkType.h>
 
 vtkSmartPointer<vtkLookupTable> GetTemperatureLUT() {
   // LUT for coloring the particles
@@ -15,14 +10,32 @@ vtkSmartPointer<vtkLookupTable> GetTemperatureLUT() {
   lut->SetAlphaRange(0.3, 0.7);
   lut->SetTableRange(0.0, 1e5);
   lut->SetNumberOfColors(512);
-  // TODO: we should probably move to a logarithm scale
+  // See GetLogTemperatureLUT() for the logarithmic scale
 
   lut->SetUseAboveRangeColor(1);
   lut->SetAboveRangeColor(0.0, 1.0, 1.0, 1.0);
   lut->SetUseBelowRangeColor(1);
   lut->SetBelowRangeColor(0.0, 1.0, 1.0, 1.0);
 
-  // lut->SetScaleToLog10();
+  lut->Build();
+
+  return lut;
+}
+
+vtkSmartPointer<vtkLookupTable> GetLogTemperatureLUT() {
+  // LUT for the "LogTemperature" column (log10 of the temperature). The
+  // column is already logarithmic, so the table itself stays linear.
+  vtkNew<vtkLookupTable> lut;
+
+  lut->SetHueRange(0.667, 0.0);
+  lut->SetAlphaRange(0.3, 0.7);
+  lut->SetTableRange(1.0, 5.0);
+  lut->SetNumberOfColors(512);
+
+  lut->SetUseAboveRangeColor(1);
+  lut->SetAboveRangeColor(0.0, 1.0, 1.0, 1.0);
+  lut->SetUseBelowRangeColor(1);
+  lut->SetBelowRangeColor(0.0, 1.0, 1.0, 1.0);
 
   lut->Build();
 
@@ -46,17 +59,16 @@ vtkSmartPointer<vtkLookupTable> GetPhiLUT() {
 vtkSmartPointer<vtkLookupTable> GetClusterLUT() {
   vtkNew<vtkLookupTable> lut;
 
-  lut->SetTableRange(0.0, 26.0);
+  // One color per cluster index (NUM_CLUSTER_COLORS), the "Cluster" column
+  // cycles through them
+  lut->SetTableRange(0.0, 25.0);
   lut->SetAlpha(0.4);
-  // categoryLut->SetNumberOfColors(27);
-  lut->SetNumberOfTableValues(27);
+  lut->SetNumberOfTableValues(26);
   lut->Build();
 
   // green
   lut->SetNanColor(0.0, 1.0, 0.0, 1.0);
 
-  // 26 is noise points (are not assigned to any cluster)
-  lut->SetTableValue(26, 0.0, 1.0, 0.0, 0.0);
   lut->SetTableValue(0, 1.0, 0.0, 0.0, 1.0);
   lut->SetTableValue(1, 0.33, 0.42, 0.18, 1.0);
   lut->SetTableValue(2, 0.54, 0.26, 0.07, 1.0);
@@ -85,8 +97,9 @@ vtkSmartPointer<vtkLookupTable> GetClusterLUT() {
   lut->SetTableValue(25, 0.93, 0.508, 0.93, 1.0);
   lut->SetUseAboveRangeColor(1);
   lut->SetAboveRangeColor(0.0, 0.0, 1.0, 1.0);
+  // Noise points (NO_CLUSTER, not assigned to any cluster) are invisible
   lut->SetUseBelowRangeColor(1);
-  lut->SetBelowRangeColor(0.0, 0.0, 0.0, 1.0);
+  lut->SetBelowRangeColor(0.0, 1.0, 0.0, 0.0);
 
   return lut;
 }
@@ -103,23 +116,3 @@ vtkSmartPointer<vtkColorTransferFunction> GetSPHLUT() {
 
   return lut;
 }
-
-vtkSmartPointer<vtkStructuredGrid> GetSPHStructuredGrid(int dimensions[3], double spacing[3], double sphOrigin[3]) {
-  vtkNew<vtkPoints> sphPoints;
-  vtkNew<vtkStructuredGrid> grid;
-
-  grid->SetDimensions(dimensions);
-
-  for (vtkIdType i = 0; i < dimensions[0]; i++) {
-    for (vtkIdType j = 0; j < dimensions[1]; j++) {
-      for (vtkIdType k = 0; k < dimensions[2]; k++) {
-        sphPoints->InsertNextPoint(sphOrigin[0] + spacing[0]*k, sphOrigin[1] + spacing[1] * j, sphOrigin[2] + i * spacing[2]);
-      }
-    }
-  }
-
-  assert (sphPoints->GetNumberOfPoints() == dimensions[0] * dimensions[1] * dimensions[2]);
-
-  grid->SetPoints(sphPoints);
-  return grid;
-}
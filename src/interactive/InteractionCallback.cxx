@@ -0,0 +1,12 @@
+#include "InteractionCallback.hxx"
+
+#include "../app/VisCos.hpp"
+
+void InteractionCallback::Execute(vtkObject *caller, unsigned long eventId,
+                                  void *) {
+  if (eventId == vtkCommand::StartInteractionEvent) {
+    app->BeginInteraction();
+  } else if (eventId == vtkCommand::EndInteractionEvent) {
+    app->EndInteraction();
+  }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vtkCommand.h>
+
+class VisCos;
+class vtkObject;
+
+// Tells the app when the trackball starts and stops moving the camera
+class InteractionCallback : public vtkCommand {
+public:
+  InteractionCallback(){};
+  static InteractionCallback *New() { return new InteractionCallback; }
+  VisCos *app;
+
+  void Execute(vtkObject *caller, unsigned long eventId, void *);
+};
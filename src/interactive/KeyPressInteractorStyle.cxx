@@ -22,6 +22,9 @@ void KeyPressInteractorStyle::OnChar() {
   if (rwi->GetKeyCode() == 'p') {
     return; // Disable boundary box (or sort some sort of box)
   }
+  if (rwi->GetKeyCode() == 'f') {
+    return; // Disable fly to, 'f' lets the SPH box follow
+  }
 
   // Forward events
   vtkInteractorStyleTrackballCamera::OnChar();
@@ -56,7 +59,8 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    // Rendered once per tick, so held keys do not queue up frames
+    app->RequestRender();
     return;
   }
 
@@ -85,7 +89,7 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    app->RequestRender();
     return;
   }
 
@@ -116,7 +120,7 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    app->RequestRender();
     return;
   }
 
@@ -147,7 +151,7 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    app->RequestRender();
     return;
   }
 
@@ -161,6 +165,11 @@ void KeyPressInteractorStyle::OnKeyPress() {
     return;
   }
 
+  if (key == "l") {
+    app->ShowLogTemperature();
+    return;
+  }
+
   if (key == "i") {
     app->ShowPhi();
     return;
@@ -171,7 +180,7 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    app->RequestRender();
     return;
   }
 
@@ -180,7 +189,7 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    app->RequestRender();
     return;
   }
 
@@ -189,7 +198,7 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    app->RequestRender();
     return;
   }
   if (key == "Down") {
@@ -197,7 +206,7 @@ void KeyPressInteractorStyle::OnKeyPress() {
     camera->Modified();
 
     app->UpdateFP();
-    renderWindow->Render();
+    app->RequestRender();
     return;
   }
 
@@ -257,6 +266,32 @@ void KeyPressInteractorStyle::OnKeyPress() {
     return;
   }
 
+  // Play/pause the animation through the timesteps
+  if (key == "space") {
+    app->TogglePlayback();
+    return;
+  }
+  if (key == "plus" || key == "KP_Add") {
+    app->SetPlaybackFps(app->GetPlaybackFps() * 1.25);
+    return;
+  }
+  if (key == "minus" || key == "KP_Subtract") {
+    app->SetPlaybackFps(app->GetPlaybackFps() * 0.8);
+    return;
+  }
+
+  // Compute the clusters of the current timestep
+  if (key == "k") {
+    app->ClusterActiveTimestep();
+    return;
+  }
+
+  // Interpolate odd and fractional timesteps between the snapshots
+  if (key == "o") {
+    app->ToggleInterpolation();
+    return;
+  }
+
   // Change amount of steps taken when the slider is moved with "[" and "]""
   if (key == "bracketleft") {
     app->lessSteps();
@@ -284,8 +319,13 @@ void KeyPressInteractorStyle::OnKeyPress() {
     printf("  * w,a,s,d to move around\n");
     printf("  * Arrow-Keys to look around\n");
     printf("  * Change amount of steps taken for moving to a timestep with '[' and ']'\n");
+    printf("  * 'space' to play/pause the animation through the timesteps\n");
+    printf("  * '+' and '-' to change the playback speed\n");
+    printf("  * 'o' to toggle interpolation between the timesteps\n");
     printf("  * 't' to show the temperature\n");
+    printf("  * 'l' to show the temperature on a logarithmic scale\n");
     printf("  * 'c' to show the clustering\n");
+    printf("  * 'k' to compute the clustering of the current timestep\n");
     printf("  * 'i' to show phi (gravitational potential)\n");
     printf("  * '0' to show all particles\n");
     printf("  * '9' to show no particles\n");
@@ -296,9 +336,11 @@ void KeyPressInteractorStyle::OnKeyPress() {
     printf("  * '4' to toggle baryon star forming\n");
     printf("  * '2' to toggle AGN particles\n");
     printf("  * 'n' to print the current position\n");
+    printf("  * 'p' to pick the particle closest to the focal point\n");
     printf("  * 'm' to jump to the SPH viewpoint\n");
     printf("  * 'g' to set the new center for SPH\n");
     printf("  * ',' to toggle SPH for the set position\n");
+    printf("  * 'f' to let the SPH box follow the focal point\n");
     printf("  * 'z' to decrease the movement speed\n");
     printf("  * 'x' to INCREASE the movement speed\n");
     printf("  * Quit with 'q'\n");
@@ -359,6 +401,20 @@ void KeyPressInteractorStyle::OnKeyPress() {
     return;
   }
 
+  if (key == "f") {
+    this->app->ToggleSPHFollow();
+    return;
+  }
+
+  // Pick and mark the particle closest to the focal point
+  if (key == "p") {
+    double fp[3];
+    this->camera->GetFocalPoint(fp);
+    this->app->PickParticle(fp, 1.0);
+    this->renderWindow->Render();
+    return;
+  }
+
   if (key == "q" || key == "Super_L") return;
 
   // Output the key that was pressed
@@ -0,0 +1,12 @@
+#include "RenderCallback.hxx"
+
+#include "../app/VisCos.hpp"
+
+void RenderCallback::Execute(vtkObject *caller, unsigned long eventId,
+                             void *) {
+  if (eventId == vtkCommand::StartEvent) {
+    app->BeforeRender();
+  } else if (eventId == vtkCommand::EndEvent) {
+    app->AfterRender();
+  }
+}
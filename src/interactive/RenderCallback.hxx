@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vtkCommand.h>
+
+class VisCos;
+class vtkObject;
+
+// Runs before (StartEvent) and after (EndEvent) every render of the
+// renderer, to pick the level of detail and to measure the frame time
+class RenderCallback : public vtkCommand {
+public:
+  RenderCallback(){};
+  static RenderCallback *New() { return new RenderCallback; }
+  VisCos *app;
+
+  void Execute(vtkObject *caller, unsigned long eventId, void *);
+};
@@ -12,6 +12,15 @@ void TimeSliderCallback::Execute(vtkObject *caller, unsigned long, void *) {
                       sliderWidget->GetRepresentation())
                       ->GetValue();
 
+  // Dragging the slider takes over from the playback
+  app->StopPlayback();
+
+  // Between the snapshots the timestep is interpolated
+  if (app->IsInterpolating()) {
+    app->MoveToTime(dvalue);
+    return;
+  }
+
   // We only have readers for even timesteps, for now.
   int val = (((int)dvalue) / 2) * 2;
 
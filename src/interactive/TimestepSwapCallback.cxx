@@ -0,0 +1,18 @@
+
+#include "TimestepSwapCallback.hxx"
+
+#include "../app/VisCos.hpp"
+
+void TimestepSwapCallback::Execute(vtkObject *caller, unsigned long,
+                                   void *callData) {
+  // Other timers (e.g. of the interactor style) are not ours
+  if (callData == nullptr || *static_cast<int *>(callData) != timerId) {
+    return;
+  }
+  this->AbortFlagOn();
+
+  app->SwapInPreparedTimestep();
+  app->SwapInSPHVolume();
+  app->SwapInClusters();
+  app->RenderPendingFrame();
+}
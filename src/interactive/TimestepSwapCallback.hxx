@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vtkCommand.h>
+
+class VisCos;
+class vtkObject;
+
+// Swaps timesteps and SPH volumes which were prepared in the background into
+// the pipeline and renders the frames requested since the last tick
+class TimestepSwapCallback : public vtkCommand {
+public:
+  TimestepSwapCallback(){};
+  static TimestepSwapCallback *New() { return new TimestepSwapCallback; }
+  VisCos *app;
+  int timerId = -1;
+
+  void Execute(vtkObject *caller, unsigned long, void *callData);
+};
@@ -11,27 +11,72 @@ namespace fs = std::filesystem;
 // Some program constants
 const std::string background("#111111");
 
+void usage(const char *name) {
+  printf("Usage is %s [OPTIONS] DATA_FOLDER_PATH\n", name);
+  printf("Options:\n");
+  printf("  --cache-budget MIB   memory for decoded snapshots (default 4096)\n");
+  printf("  --prefetch K         timesteps decoded ahead (default 2)\n");
+  printf("  --sph-resolution N   voxels per axis of the finest SPH volume "
+         "(default 140)\n");
+  printf("  --point-budget N     most particles drawn per frame, far away ones "
+         "are subsampled (default 2000000)\n");
+  printf("  --float32            keep positions and scalar columns in single "
+         "precision\n");
+  printf("  --target-fps F       frame rate kept while moving the camera "
+         "(default 30)\n");
+}
+
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    printf("Usage is %s DATA_FOLDER_PATH\n", argv[0]);
+  std::string data_folder_path;
+  size_t cache_budget_mib = 4096;
+  int prefetch_distance = 2;
+  int sph_resolution = 140;
+  long long point_budget = 2000000;
+  double target_fps = 30.0;
+  bool float32 = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--cache-budget" && i + 1 < argc) {
+      cache_budget_mib = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--prefetch" && i + 1 < argc) {
+      prefetch_distance = atoi(argv[++i]);
+    } else if (arg == "--sph-resolution" && i + 1 < argc) {
+      sph_resolution = atoi(argv[++i]);
+    } else if (arg == "--point-budget" && i + 1 < argc) {
+      point_budget = atoll(argv[++i]);
+    } else if (arg == "--float32") {
+      float32 = true;
+    } else if (arg == "--target-fps" && i + 1 < argc) {
+      target_fps = atof(argv[++i]);
+    } else if (data_folder_path.empty() && arg.rfind("--", 0) != 0) {
+      data_folder_path = arg;
+    } else {
+      usage(argv[0]);
+      return 0;
+    }
+  }
+  if (data_folder_path.empty()) {
+    usage(argv[0]);
     return 0;
   }
-  std::string data_folder_path;
-  data_folder_path = argv[1];
 
   if (!std::filesystem::exists(data_folder_path)) {
     printf("The data folder path does not exist: %s. It has to contain the *.vtp files.\n", data_folder_path.c_str());
     return 0;
   }
 
+  // Optional, VisCosTool cluster computes the clusters of every timestep
   std::string cluster_path(data_folder_path);
   cluster_path.append("/clusters.vtp");
-  if (!std::filesystem::exists(cluster_path)) {
-    printf("The clusters file is missing at %s. Please read the README.md on how to generate it.\n", cluster_path.c_str());
-    return 0;
-  }
 
   VisCos app(566, data_folder_path, cluster_path);
+  app.SetCacheBudget(cache_budget_mib * 1024 * 1024);
+  app.SetPrefetchDistance(prefetch_distance);
+  app.SetSinglePrecision(float32);
+  app.SetSPHResolution(sph_resolution);
+  app.SetPointBudget(point_budget);
+  app.SetTargetFps(target_fps);
 
   // Load the data
   app.Load();
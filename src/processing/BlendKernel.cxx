@@ -0,0 +1,114 @@
+#include <cmath> // for floor, nearbyint
+
+#include "BlendKernel.hxx"
+#include "Simd.hxx"
+
+namespace {
+
+// Rounds like the SIMD kernels (to nearest even), which keeps the tails of
+// the vectorised loops consistent with their bodies
+template <bool WithTangent>
+void BlendScalar(const float *a, const float *b, const float *tangent,
+                 vtkIdType n, float h01, float boxSize, float *out) {
+  const float inverse = 1.0f / boxSize;
+  for (vtkIdType e = 0; e < n; e++) {
+    float p0 = a[e];
+    float d = b[e] - p0;
+    d -= boxSize * std::nearbyint(d * inverse);
+    float p = p0 + h01 * d;
+    if (WithTangent) {
+      p += tangent[e];
+    }
+    out[e] = p - boxSize * std::floor(p * inverse);
+  }
+}
+
+#ifdef VISCOS_X86_SIMD
+
+template <bool WithTangent>
+__attribute__((target("avx2"))) void
+BlendAVX2(const float *a, const float *b, const float *tangent, vtkIdType n,
+          float h01, float boxSize, float *out) {
+  const __m256 box = _mm256_set1_ps(boxSize);
+  const __m256 inverse = _mm256_set1_ps(1.0f / boxSize);
+  const __m256 h = _mm256_set1_ps(h01);
+  vtkIdType e = 0;
+  for (; e + 8 <= n; e += 8) {
+    __m256 p0 = _mm256_loadu_ps(a + e);
+    __m256 d = _mm256_sub_ps(_mm256_loadu_ps(b + e), p0);
+    __m256 image =
+        _mm256_round_ps(_mm256_mul_ps(d, inverse),
+                        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    d = _mm256_sub_ps(d, _mm256_mul_ps(box, image));
+    __m256 p = _mm256_add_ps(p0, _mm256_mul_ps(h, d));
+    if (WithTangent) {
+      p = _mm256_add_ps(p, _mm256_loadu_ps(tangent + e));
+    }
+    __m256 wraps = _mm256_floor_ps(_mm256_mul_ps(p, inverse));
+    _mm256_storeu_ps(out + e, _mm256_sub_ps(p, _mm256_mul_ps(box, wraps)));
+  }
+  BlendScalar<WithTangent>(a + e, b + e, WithTangent ? tangent + e : nullptr,
+                           n - e, h01, boxSize, out + e);
+}
+
+template <bool WithTangent>
+__attribute__((target("avx512f"))) void
+BlendAVX512(const float *a, const float *b, const float *tangent, vtkIdType n,
+            float h01, float boxSize, float *out) {
+  const __m512 box = _mm512_set1_ps(boxSize);
+  const __m512 inverse = _mm512_set1_ps(1.0f / boxSize);
+  const __m512 h = _mm512_set1_ps(h01);
+  vtkIdType e = 0;
+  for (; e + 16 <= n; e += 16) {
+    __m512 p0 = _mm512_loadu_ps(a + e);
+    __m512 d = _mm512_sub_ps(_mm512_loadu_ps(b + e), p0);
+    __m512 image =
+        _mm512_roundscale_ps(_mm512_mul_ps(d, inverse),
+                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    d = _mm512_sub_ps(d, _mm512_mul_ps(box, image));
+    __m512 p = _mm512_add_ps(p0, _mm512_mul_ps(h, d));
+    if (WithTangent) {
+      p = _mm512_add_ps(p, _mm512_loadu_ps(tangent + e));
+    }
+    __m512 wraps =
+        _mm512_roundscale_ps(_mm512_mul_ps(p, inverse),
+                             _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    _mm512_storeu_ps(out + e, _mm512_sub_ps(p, _mm512_mul_ps(box, wraps)));
+  }
+  BlendScalar<WithTangent>(a + e, b + e, WithTangent ? tangent + e : nullptr,
+                           n - e, h01, boxSize, out + e);
+}
+
+#endif
+
+template <bool WithTangent>
+void Blend(const float *a, const float *b, const float *tangent, vtkIdType n,
+           float h01, float boxSize, float *out) {
+  switch (DetectSimd()) {
+#ifdef VISCOS_X86_SIMD
+  case SimdLevel::AVX512:
+    BlendAVX512<WithTangent>(a, b, tangent, n, h01, boxSize, out);
+    return;
+  case SimdLevel::AVX2:
+    BlendAVX2<WithTangent>(a, b, tangent, n, h01, boxSize, out);
+    return;
+#endif
+  default:
+    BlendScalar<WithTangent>(a, b, tangent, n, h01, boxSize, out);
+  }
+}
+
+} // namespace
+
+void BlendPositions(const float *a, const float *b, const float *tangent,
+                    vtkIdType n, float h01, float boxSize, float *out) {
+  if (tangent != nullptr) {
+    Blend<true>(a, b, tangent, n, h01, boxSize, out);
+  } else {
+    Blend<false>(a, b, nullptr, n, h01, boxSize, out);
+  }
+}
+
+const char *BlendKernelName() {
+  return SimdLevelName(DetectSimd());
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vtkType.h> // for vtkIdType
+
+/*
+  Blends n floats of interleaved positions (x, y, z, x, ...) in a periodic
+  box of edge boxSize:
+
+    d      = b[e] - a[e], wrapped to the nearest image
+    out[e] = a[e] + h01 * d + tangent[e], wrapped into [0, boxSize)
+
+  tangent holds the Hermite tangent terms and may be nullptr, then with
+  h01 = t this is the linear blend. Uses AVX-512 or AVX2 when the CPU
+  supports it (checked once at runtime) and a scalar loop otherwise.
+*/
+void BlendPositions(const float *a, const float *b, const float *tangent,
+                    vtkIdType n, float h01, float boxSize, float *out);
+
+// Name of the SIMD instruction set BlendPositions uses on this CPU
+const char *BlendKernelName();
@@ -0,0 +1,429 @@
+#include <algorithm> // for max, min
+#include <atomic>
+#include <cmath>     // for round
+#include <numeric>   // for partial_sum
+#include <vector>
+
+#include <vtkArrayDispatch.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkDataObject.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkType.h> // for vtkIdType
+
+#include "BlendKernel.hxx"
+#include "InterpolateSnapshots.hxx"
+
+namespace {
+
+// Edge length of the simulation box in Mpc/h, positions wrap around
+const float BOX_SIZE = 64.0f;
+
+vtkSmartPointer<vtkFloatArray> AsFloatArray(vtkDataArray *arr) {
+  vtkFloatArray *floats = vtkFloatArray::FastDownCast(arr);
+  if (floats != nullptr) {
+    return floats;
+  }
+  vtkSmartPointer<vtkFloatArray> copy = vtkSmartPointer<vtkFloatArray>::New();
+  copy->DeepCopy(arr);
+  return copy;
+}
+
+// Maps every particle id to its index. The ids of the snapshots are dense
+// (0 to number of particles - 1), so a flat table is enough. The ids are
+// unique, so the table is filled in parallel.
+struct IdIndexWorker {
+  std::vector<vtkIdType> index;
+
+  template <typename ArrayT> void operator()(ArrayT *ids) {
+    vtkSMPThreadLocal<vtkIdType> localMax(-1);
+    auto findMax = [&](vtkIdType begin, vtkIdType end) {
+      vtkIdType &maxId = localMax.Local();
+      for (auto id : vtk::DataArrayValueRange<1>(ids, begin, end)) {
+        maxId = std::max(maxId, static_cast<vtkIdType>(id));
+      }
+    };
+    vtkSMPTools::For(0, ids->GetNumberOfTuples(), findMax);
+
+    vtkIdType maxId = -1;
+    for (vtkIdType localId : localMax) {
+      maxId = std::max(maxId, localId);
+    }
+
+    index.assign(maxId + 1, -1);
+    auto fill = [&](vtkIdType begin, vtkIdType end) {
+      vtkIdType i = begin;
+      for (auto id : vtk::DataArrayValueRange<1>(ids, begin, end)) {
+        if (id >= 0) {
+          index[static_cast<vtkIdType>(id)] = i;
+        }
+        i++;
+      }
+    };
+    vtkSMPTools::For(0, ids->GetNumberOfTuples(), fill);
+  }
+};
+
+std::vector<vtkIdType> BuildIdIndex(vtkDataArray *ids) {
+  IdIndexWorker worker;
+  if (!vtkArrayDispatch::Dispatch::Execute(ids, worker)) {
+    worker(ids);
+  }
+  return worker.index;
+}
+
+// Looks up the index in b of every particle of a (-1 if b lacks it)
+struct PartnerWorker {
+  const std::vector<vtkIdType> *indexB;
+  std::vector<vtkIdType> partner;
+  // Whether every particle has the same index in both snapshots
+  std::atomic<bool> sameOrder{true};
+
+  template <typename ArrayT> void operator()(ArrayT *ids) {
+    partner.resize(ids->GetNumberOfTuples());
+    const vtkIdType numB = static_cast<vtkIdType>(indexB->size());
+    auto lookup = [&](vtkIdType begin, vtkIdType end) {
+      bool same = true;
+      vtkIdType i = begin;
+      for (auto value : vtk::DataArrayValueRange<1>(ids, begin, end)) {
+        vtkIdType id = static_cast<vtkIdType>(value);
+        vtkIdType j = id >= 0 && id < numB ? (*indexB)[id] : -1;
+        partner[i] = j;
+        same = same && j == i;
+        i++;
+      }
+      if (!same) {
+        sameOrder.store(false, std::memory_order_relaxed);
+      }
+    };
+    vtkSMPTools::For(0, ids->GetNumberOfTuples(), lookup);
+  }
+};
+
+// Particles per chunk of the join, see JoinById()
+const vtkIdType JOIN_CHUNK = 65536;
+
+/*
+  Joins the particles of a and b by id: the k-th particle of the output is
+  matchA[k] in a and matchB[k] in b. The matched particles are compacted in
+  two parallel passes, every chunk counts its matches and then scatters them
+  to the prefix sum of the counts.
+
+  Returns whether the snapshots hold the same particles in the same order.
+*/
+bool JoinById(vtkDataArray *idsA, vtkDataArray *idsB,
+              std::vector<vtkIdType> &matchA, std::vector<vtkIdType> &matchB) {
+  std::vector<vtkIdType> indexB = BuildIdIndex(idsB);
+
+  PartnerWorker worker;
+  worker.indexB = &indexB;
+  if (!vtkArrayDispatch::Dispatch::Execute(idsA, worker)) {
+    worker(idsA);
+  }
+  const vtkIdType *partner = worker.partner.data();
+  const vtkIdType numA = static_cast<vtkIdType>(worker.partner.size());
+
+  vtkIdType numChunks = (numA + JOIN_CHUNK - 1) / JOIN_CHUNK;
+  std::vector<vtkIdType> offsets(numChunks + 1, 0);
+  auto count = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType chunk = begin; chunk < end; chunk++) {
+      vtkIdType last = std::min((chunk + 1) * JOIN_CHUNK, numA);
+      vtkIdType matched = 0;
+      for (vtkIdType i = chunk * JOIN_CHUNK; i < last; i++) {
+        matched += partner[i] >= 0;
+      }
+      offsets[chunk + 1] = matched;
+    }
+  };
+  vtkSMPTools::For(0, numChunks, count);
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+  matchA.resize(offsets.back());
+  matchB.resize(offsets.back());
+  auto scatter = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType chunk = begin; chunk < end; chunk++) {
+      vtkIdType last = std::min((chunk + 1) * JOIN_CHUNK, numA);
+      vtkIdType k = offsets[chunk];
+      for (vtkIdType i = chunk * JOIN_CHUNK; i < last; i++) {
+        if (partner[i] >= 0) {
+          matchA[k] = i;
+          matchB[k] = partner[i];
+          k++;
+        }
+      }
+    }
+  };
+  vtkSMPTools::For(0, numChunks, scatter);
+
+  return worker.sameOrder.load() && idsB->GetNumberOfTuples() == numA;
+}
+
+struct HermiteParams {
+  const float *posA;
+  const float *posB;
+  // nullptr without velocities, the positions are then blended linearly
+  const float *velA[3];
+  const float *velB[3];
+  const vtkIdType *matchA;
+  const vtkIdType *matchB;
+  float *out;
+
+  // Hermite basis functions at t, h00 is folded into the position delta
+  float h01, h10, h11;
+  // Converts velocities into position tangents over the interval
+  float tangentScale;
+};
+
+// Particles per block of HermiteBlend, its buffers stay in the L1/L2 cache
+const vtkIdType BLOCK = 1024;
+
+struct BlendBuffers {
+  std::vector<float> a;
+  std::vector<float> b;
+  std::vector<float> tangent;
+};
+
+/*
+  Blends the matched particles k = [begin, end) block by block. Matched
+  particles are first gathered into contiguous blocks (with Identity the
+  k-th particle is at index k in both snapshots and the positions are used
+  in place), the tangents of the block are computed from the velocity
+  columns, and BlendPositions() runs over the interleaved coordinates with
+  SIMD.
+*/
+template <bool Identity> struct HermiteBlend : HermiteParams {
+  vtkSMPThreadLocal<BlendBuffers> *buffers;
+
+  void operator()(vtkIdType begin, vtkIdType end) const {
+    BlendBuffers &buffer = buffers->Local();
+    if (buffer.tangent.empty()) {
+      buffer.a.resize(3 * BLOCK);
+      buffer.b.resize(3 * BLOCK);
+      buffer.tangent.resize(3 * BLOCK);
+    }
+    const bool withTangents = velA[0] != nullptr;
+
+    for (vtkIdType k0 = begin; k0 < end; k0 += BLOCK) {
+      vtkIdType len = std::min(BLOCK, end - k0);
+
+      const float *a = posA + 3 * k0;
+      const float *b = posB + 3 * k0;
+      if (!Identity) {
+        float *__restrict ga = buffer.a.data();
+        float *__restrict gb = buffer.b.data();
+        for (vtkIdType k = 0; k < len; k++) {
+          vtkIdType i = matchA[k0 + k];
+          vtkIdType j = matchB[k0 + k];
+          for (int c = 0; c < 3; c++) {
+            ga[3 * k + c] = posA[3 * i + c];
+            gb[3 * k + c] = posB[3 * j + c];
+          }
+        }
+        a = ga;
+        b = gb;
+      }
+
+      const float *tangent = nullptr;
+      if (withTangents) {
+        float *__restrict t = buffer.tangent.data();
+        for (vtkIdType k = 0; k < len; k++) {
+          vtkIdType i = Identity ? k0 + k : matchA[k0 + k];
+          vtkIdType j = Identity ? k0 + k : matchB[k0 + k];
+          for (int c = 0; c < 3; c++) {
+            t[3 * k + c] =
+                tangentScale * (h10 * velA[c][i] + h11 * velB[c][j]);
+          }
+        }
+        tangent = t;
+      }
+
+      BlendPositions(a, b, tangent, 3 * len, h01, BOX_SIZE, out + 3 * k0);
+    }
+  }
+};
+
+template <bool Identity> struct LinearBlend {
+  const float *a;
+  const float *b;
+  const vtkIdType *matchA;
+  const vtkIdType *matchB;
+  float *out;
+  float t;
+
+  void operator()(vtkIdType begin, vtkIdType end) const {
+    const float *__restrict pa = a;
+    const float *__restrict pb = b;
+    float *__restrict o = out;
+
+    for (vtkIdType k = begin; k < end; k++) {
+      vtkIdType i = Identity ? k : matchA[k];
+      vtkIdType j = Identity ? k : matchB[k];
+      o[k] = pa[i] + t * (pb[j] - pa[i]);
+    }
+  }
+};
+
+} // namespace
+
+vtkSmartPointer<vtkPolyData> InterpolateSnapshots(vtkPolyData *a,
+                                                  vtkPolyData *b, double t,
+                                                  double time) {
+  vtkPointData *pdA = a->GetPointData();
+  vtkPointData *pdB = b->GetPointData();
+
+  // Join the particles of both snapshots by id
+  std::vector<vtkIdType> matchA;
+  std::vector<vtkIdType> matchB;
+  bool identity =
+      JoinById(pdA->GetArray("id"), pdB->GetArray("id"), matchA, matchB);
+  vtkIdType n = static_cast<vtkIdType>(matchA.size());
+
+  vtkSmartPointer<vtkFloatArray> posA = AsFloatArray(a->GetPoints()->GetData());
+  vtkSmartPointer<vtkFloatArray> posB = AsFloatArray(b->GetPoints()->GetData());
+
+  // Without velocities (not stored, or not loaded) the positions are
+  // blended linearly
+  vtkSmartPointer<vtkFloatArray> velA[3];
+  vtkSmartPointer<vtkFloatArray> velB[3];
+  const char *velNames[3] = {"vx", "vy", "vz"};
+  bool hasVelocities = true;
+  for (int c = 0; c < 3; c++) {
+    vtkDataArray *arrA = pdA->GetArray(velNames[c]);
+    vtkDataArray *arrB = pdB->GetArray(velNames[c]);
+    if (arrA == nullptr || arrB == nullptr) {
+      hasVelocities = false;
+      break;
+    }
+    velA[c] = AsFloatArray(arrA);
+    velB[c] = AsFloatArray(arrB);
+  }
+
+  // The velocities are in km/s, the positions in comoving Mpc/h. Instead of
+  // modelling the cosmology we fit the factor which maps the mean velocity
+  // onto the displacement over the interval (least squares on a sample).
+  double dotDV = 0;
+  double dotVV = 0;
+  for (vtkIdType k = 0; hasVelocities && k < n; k += 97) {
+    vtkIdType i = matchA[k];
+    vtkIdType j = matchB[k];
+    for (int c = 0; c < 3; c++) {
+      double d = posB->GetValue(3 * j + c) - posA->GetValue(3 * i + c);
+      d -= BOX_SIZE * std::round(d / BOX_SIZE);
+      double v = 0.5 * (velA[c]->GetValue(i) + velB[c]->GetValue(j));
+      dotDV += d * v;
+      dotVV += v * v;
+    }
+  }
+  double tangentScale = dotVV > 0 ? std::max(dotDV / dotVV, 0.0) : 0.0;
+
+  double t2 = t * t;
+  double t3 = t2 * t;
+
+  vtkNew<vtkFloatArray> positions;
+  positions->SetNumberOfComponents(3);
+  positions->SetNumberOfTuples(n);
+
+  const vtkIdType *mA = matchA.data();
+  const vtkIdType *mB = matchB.data();
+
+  HermiteParams hermite;
+  hermite.posA = posA->GetPointer(0);
+  hermite.posB = posB->GetPointer(0);
+  for (int c = 0; c < 3; c++) {
+    hermite.velA[c] = hasVelocities ? velA[c]->GetPointer(0) : nullptr;
+    hermite.velB[c] = hasVelocities ? velB[c]->GetPointer(0) : nullptr;
+  }
+  hermite.matchA = mA;
+  hermite.matchB = mB;
+  hermite.out = positions->GetPointer(0);
+  if (hasVelocities) {
+    hermite.h01 = static_cast<float>(-2 * t3 + 3 * t2);
+    hermite.h10 = static_cast<float>(t3 - 2 * t2 + t);
+    hermite.h11 = static_cast<float>(t3 - t2);
+  } else {
+    hermite.h01 = static_cast<float>(t);
+    hermite.h10 = 0;
+    hermite.h11 = 0;
+  }
+  hermite.tangentScale = static_cast<float>(tangentScale);
+
+  vtkSMPThreadLocal<BlendBuffers> buffers;
+  if (identity) {
+    HermiteBlend<true> blend{hermite, &buffers};
+    vtkSMPTools::For(0, n, blend);
+  } else {
+    HermiteBlend<false> blend{hermite, &buffers};
+    vtkSMPTools::For(0, n, blend);
+  }
+
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetData(positions);
+  output->SetPoints(points);
+
+  // Integer columns are taken from the nearer snapshot
+  vtkPolyData *nearer = t < 0.5 ? a : b;
+  const std::vector<vtkIdType> &nearerMatch = t < 0.5 ? matchA : matchB;
+  vtkNew<vtkIdList> nearerIds;
+  if (!identity) {
+    nearerIds->SetNumberOfIds(n);
+    std::copy(nearerMatch.begin(), nearerMatch.end(), nearerIds->GetPointer(0));
+  }
+
+  for (int i = 0; i < pdA->GetNumberOfArrays(); i++) {
+    vtkDataArray *arrA = pdA->GetArray(i);
+    if (arrA == nullptr || arrA->GetName() == nullptr) {
+      continue;
+    }
+    vtkDataArray *arrB = pdB->GetArray(arrA->GetName());
+    if (arrB == nullptr || arrA->GetNumberOfComponents() != 1) {
+      continue;
+    }
+
+    int type = arrA->GetDataType();
+    if (type == VTK_FLOAT || type == VTK_DOUBLE) {
+      vtkSmartPointer<vtkFloatArray> floatA = AsFloatArray(arrA);
+      vtkSmartPointer<vtkFloatArray> floatB = AsFloatArray(arrB);
+
+      vtkNew<vtkFloatArray> blended;
+      blended->SetName(arrA->GetName());
+      blended->SetNumberOfTuples(n);
+
+      if (identity) {
+        LinearBlend<true> blend{floatA->GetPointer(0), floatB->GetPointer(0),
+                                mA, mB, blended->GetPointer(0),
+                                static_cast<float>(t)};
+        vtkSMPTools::For(0, n, blend);
+      } else {
+        LinearBlend<false> blend{floatA->GetPointer(0), floatB->GetPointer(0),
+                                 mA, mB, blended->GetPointer(0),
+                                 static_cast<float>(t)};
+        vtkSMPTools::For(0, n, blend);
+      }
+      output->GetPointData()->AddArray(blended);
+    } else {
+      vtkDataArray *source = nearer->GetPointData()->GetArray(arrA->GetName());
+      if (identity) {
+        output->GetPointData()->AddArray(source);
+      } else {
+        vtkSmartPointer<vtkDataArray> gathered =
+            vtkSmartPointer<vtkDataArray>::Take(source->NewInstance());
+        gathered->SetName(source->GetName());
+        source->GetTuples(nearerIds, gathered);
+        output->GetPointData()->AddArray(gathered);
+      }
+    }
+  }
+
+  output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), time);
+
+  return output;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vtkSmartPointer.h>
+
+class vtkPolyData;
+
+/*
+  Creates an in-between snapshot of a and b at the given time.
+
+  Particles are joined by their "id". Positions follow a cubic Hermite curve
+  whose tangents are the stored velocities (vx, vy, vz), taking the periodic
+  box into account; without velocity columns they are blended linearly. All
+  other floating point columns are blended linearly, integer columns (mask,
+  id) are taken from the nearer snapshot.
+
+  t is the blend factor in [0, 1] between a and b.
+*/
+vtkSmartPointer<vtkPolyData> InterpolateSnapshots(vtkPolyData *a,
+                                                  vtkPolyData *b, double t,
+                                                  double time);
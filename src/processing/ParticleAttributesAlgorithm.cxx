@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <vector>
+
+#include <vtkArrayDispatch.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkDataObject.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkIndent.h> // for vtkIndent
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkShortArray.h>
+#include <vtkSmartPointer.h>
+#include <vtkType.h> // for vtkIdType
+
+#include "ParticleAttributesAlgorithm.hxx"
+#include "TemperatureKernel.hxx"
+
+namespace {
+
+/*
+  The per point part of the sweep: temperature from the internal energy,
+  the cluster from the id and the type signature from the mask.
+*/
+struct AttributesWorker {
+  const ClusterTable *clustering;
+  // Temperature per unit of uu at the time of the snapshot
+  double temperatureFactor;
+  // One of them is set, depending on the precision of the column
+  double *temperature;
+  float *temperatureSingle;
+  // nullptr unless the log10 column is wanted
+  float *logTemperature;
+  short *cluster;
+  uint16_t *signature;
+
+  template <typename UUArrayT, typename IdArrayT, typename MaskArrayT>
+  void operator()(UUArrayT *uu, IdArrayT *ids, MaskArrayT *mask) {
+    const ClusterTable &table = *clustering;
+    const vtkIdType tableSize = static_cast<vtkIdType>(table.size());
+
+    auto sweep = [&](vtkIdType begin, vtkIdType end) {
+      if (temperatureSingle != nullptr) {
+        ComputeTemperature(uu, begin, end, temperatureFactor,
+                           temperatureSingle, logTemperature);
+      } else {
+        ComputeTemperature(uu, begin, end, temperatureFactor, temperature,
+                           logTemperature);
+      }
+
+      const auto idRange = vtk::DataArrayValueRange<1>(ids, begin, end);
+      const auto maskRange = vtk::DataArrayValueRange<1>(mask, begin, end);
+
+      for (vtkIdType k = 0; k < end - begin; k++) {
+        vtkIdType i = begin + k;
+
+        vtkIdType id = static_cast<vtkIdType>(idRange[k]);
+        cluster[i] = id >= 0 && id < tableSize ? table[id] : NO_CLUSTER;
+
+        signature[i] = TypeSignature(static_cast<uint16_t>(maskRange[k]));
+      }
+    };
+    vtkSMPTools::For(0, uu->GetNumberOfTuples(), sweep);
+  }
+};
+
+// uu is stored as float or double, id and mask as some integer type
+using AttributesDispatch =
+    vtkArrayDispatch::Dispatch3ByValueType<vtkArrayDispatch::Reals,
+                                           vtkArrayDispatch::Integrals,
+                                           vtkArrayDispatch::Integrals>;
+
+} // namespace
+
+vtkStandardNewMacro(ParticleAttributesAlgorithm);
+
+ParticleAttributesAlgorithm::ParticleAttributesAlgorithm() {
+  this->SetNumberOfInputPorts(1);
+  this->SetNumberOfOutputPorts(3);
+}
+
+ParticleAttributesAlgorithm::~ParticleAttributesAlgorithm() {}
+
+void ParticleAttributesAlgorithm::PrintSelf(ostream &os, vtkIndent indent) {
+  this->Superclass::PrintSelf(os, indent);
+}
+
+void ParticleAttributesAlgorithm::SetComputeLogTemperature(bool compute) {
+  if (this->computeLogTemperature != compute) {
+    this->computeLogTemperature = compute;
+    this->Modified();
+  }
+}
+
+bool ParticleAttributesAlgorithm::GetComputeLogTemperature() {
+  return this->computeLogTemperature;
+}
+
+void ParticleAttributesAlgorithm::SetSinglePrecision(bool single) {
+  if (this->singlePrecision != single) {
+    this->singlePrecision = single;
+    this->Modified();
+  }
+}
+
+void ParticleAttributesAlgorithm::SetProduceBaryons(bool produce) {
+  if (this->produceBaryons != produce) {
+    this->produceBaryons = produce;
+    this->Modified();
+  }
+}
+
+void ParticleAttributesAlgorithm::SetClusterTable(const ClusterTable *table) {
+  if (this->clusterTable != table) {
+    this->clusterTable = table;
+    this->Modified();
+  }
+}
+
+std::shared_ptr<const ParticleTypeBuckets>
+ParticleAttributesAlgorithm::GetTypeBuckets() {
+  return this->typeBuckets;
+}
+
+vtkPolyData *ParticleAttributesAlgorithm::GetParticlesOutput() {
+  return this->GetOutput(0);
+}
+
+vtkPolyData *ParticleAttributesAlgorithm::GetStarsOutput() {
+  return this->GetOutput(1);
+}
+
+vtkPolyData *ParticleAttributesAlgorithm::GetBaryonsOutput() {
+  return this->GetOutput(2);
+}
+
+int ParticleAttributesAlgorithm::RequestData(
+    vtkInformation *vtkNotUsed(request), vtkInformationVector **inputVector,
+    vtkInformationVector *outputVector) {
+  vtkPolyData *input = vtkPolyData::GetData(inputVector[0]);
+  vtkPolyData *particles = vtkPolyData::GetData(outputVector, 0);
+  vtkPolyData *stars = vtkPolyData::GetData(outputVector, 1);
+  vtkPolyData *baryons = vtkPolyData::GetData(outputVector, 2);
+
+  vtkIdType numPts = input->GetNumberOfPoints();
+
+  vtkDataArray *uu = input->GetPointData()->GetArray("uu");
+  vtkDataArray *ids = input->GetPointData()->GetArray("id");
+  vtkDataArray *mask = input->GetPointData()->GetArray("mask");
+  if (uu == nullptr || ids == nullptr || mask == nullptr) {
+    vtkErrorMacro("The snapshot needs the uu, id and mask arrays");
+    return 0;
+  }
+
+  vtkInformation *info = input->GetInformation();
+  double dtimestep = info->Get(vtkDataObject::DATA_TIME_STEP());
+
+  vtkSmartPointer<vtkDataArray> temperature;
+  if (this->singlePrecision) {
+    temperature = vtkSmartPointer<vtkFloatArray>::New();
+  } else {
+    temperature = vtkSmartPointer<vtkDoubleArray>::New();
+  }
+  temperature->SetName("Temperature");
+  temperature->SetNumberOfComponents(1);
+  temperature->SetNumberOfTuples(numPts);
+
+  vtkNew<vtkShortArray> cluster;
+  cluster->SetName("Cluster");
+  cluster->SetNumberOfComponents(1);
+  cluster->SetNumberOfTuples(numPts);
+
+  vtkNew<vtkFloatArray> logTemperature;
+  if (this->computeLogTemperature) {
+    logTemperature->SetName("LogTemperature");
+    logTemperature->SetNumberOfComponents(1);
+    logTemperature->SetNumberOfTuples(numPts);
+  }
+
+  std::vector<uint16_t> signatures(numPts);
+
+  ClusterTable noClusters;
+  AttributesWorker worker;
+  worker.clustering = this->clusterTable ? this->clusterTable : &noClusters;
+  worker.temperatureFactor = TemperatureFactor(dtimestep);
+  worker.temperature =
+      this->singlePrecision
+          ? nullptr
+          : vtkDoubleArray::SafeDownCast(temperature)->GetPointer(0);
+  worker.temperatureSingle =
+      this->singlePrecision
+          ? vtkFloatArray::SafeDownCast(temperature)->GetPointer(0)
+          : nullptr;
+  worker.logTemperature =
+      this->computeLogTemperature ? logTemperature->GetPointer(0) : nullptr;
+  worker.cluster = cluster->GetPointer(0);
+  worker.signature = signatures.data();
+
+  if (!AttributesDispatch::Execute(uu, ids, mask, worker)) {
+    worker(uu, ids, mask);
+  }
+
+  particles->ShallowCopy(input);
+  particles->GetPointData()->AddArray(temperature);
+  particles->GetPointData()->AddArray(cluster);
+  if (this->computeLogTemperature) {
+    particles->GetPointData()->AddArray(logTemperature);
+  }
+
+  std::shared_ptr<ParticleTypeBuckets> buckets =
+      BuildParticleTypeBuckets(signatures);
+  this->typeBuckets = buckets;
+
+  // The subsets are gathered from the buckets instead of another sweep
+  vtkSmartPointer<vtkIdList> starIds =
+      CollectBuckets(*buckets, [](uint16_t signature) {
+        return (signature & static_cast<uint16_t>(Selector::BARYON_STAR)) != 0;
+      });
+  const std::vector<const char *> noArrays;
+  stars->ShallowCopy(ExtractPoints(particles, starIds, &noArrays));
+
+  if (this->produceBaryons) {
+    vtkSmartPointer<vtkIdList> baryonIds =
+        CollectBuckets(*buckets, [](uint16_t signature) {
+          return (signature & 0b10) != 0;
+        });
+    const std::vector<const char *> baryonArrays{"mass", "rho", "hh",
+                                                 "Temperature"};
+    baryons->ShallowCopy(ExtractPoints(particles, baryonIds, &baryonArrays));
+  }
+
+  return 1;
+}
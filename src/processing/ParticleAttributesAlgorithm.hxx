@@ -0,0 +1,98 @@
+#pragma once
+
+#include <iosfwd> // for ostream
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <vtkIOStream.h> // for ostream
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSetGet.h> // for vtkTypeMacro
+
+#include "ParticleTypeFilter.hxx"
+
+class vtkIndent;
+class vtkInformation;
+class vtkInformationVector;
+class vtkPolyData;
+
+// Cluster of the particles which belong to no cluster (noise), below the
+// range of the cluster LUT so it is drawn transparent
+const short NO_CLUSTER = -1;
+
+// Colors of the cluster LUT. The clusters are numbered by size, the
+// "Cluster" column cycles through the colors (label % NUM_CLUSTER_COLORS).
+const short NUM_CLUSTER_COLORS = 26;
+
+// Color index of a cluster label (NO_CLUSTER for noise)
+inline short cluster_color(int64_t label) {
+  return label < 0 ? NO_CLUSTER
+                   : static_cast<short>(label % NUM_CLUSTER_COLORS);
+}
+
+// Color index (see cluster_color) of the cluster of every particle, indexed
+// by the particle id
+typedef std::vector<short> ClusterTable;
+
+/*
+  Derives everything the views need of a snapshot in one parallel sweep over
+  its points (replaces the temperature, cluster, star and baryon filters):
+
+    * output 0: the snapshot with the "Temperature" and "Cluster" (color
+      index of the cluster, NO_CLUSTER for noise) columns
+      (and "LogTemperature" if enabled)
+    * output 1: the star particles (points only)
+    * output 2: the baryons with "mass", "rho", "hh" and "Temperature" (for
+      SPH)
+
+  The sweep also sorts the points into ParticleTypeBuckets, from which the
+  star and baryon subsets are gathered and which the type filter reuses.
+  The baryons can be switched off while nothing on screen needs them, their
+  output stays empty then.
+*/
+class ParticleAttributesAlgorithm : public vtkPolyDataAlgorithm {
+public:
+  static ParticleAttributesAlgorithm *New();
+  vtkTypeMacro(ParticleAttributesAlgorithm, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent) override;
+
+  // id -> cluster ID, the table has to outlive the next Update()
+  void SetClusterTable(const ClusterTable *table);
+
+  // Adds the log10 of the temperature as "LogTemperature" to output 0, for
+  // the log scaled temperature view. Off by default.
+  void SetComputeLogTemperature(bool compute);
+  bool GetComputeLogTemperature();
+
+  // Stores "Temperature" as float instead of double (it is still computed
+  // in double). Off by default.
+  void SetSinglePrecision(bool single);
+
+  // Whether output 2 (baryons) is gathered. On by default.
+  void SetProduceBaryons(bool produce);
+
+  // Buckets of output 0, built by the last execution
+  std::shared_ptr<const ParticleTypeBuckets> GetTypeBuckets();
+
+  vtkPolyData *GetParticlesOutput();
+  vtkPolyData *GetStarsOutput();
+  vtkPolyData *GetBaryonsOutput();
+
+protected:
+  ParticleAttributesAlgorithm();
+  ~ParticleAttributesAlgorithm() override;
+
+  int RequestData(vtkInformation *request, vtkInformationVector **inputVector,
+                  vtkInformationVector *outputVector) override;
+
+private:
+  ParticleAttributesAlgorithm(
+      const ParticleAttributesAlgorithm &);            // Not implemented.
+  void operator=(const ParticleAttributesAlgorithm &); // Not implemented.
+
+  const ClusterTable *clusterTable = nullptr;
+  bool computeLogTemperature = false;
+  bool singlePrecision = false;
+  bool produceBaryons = true;
+  std::shared_ptr<const ParticleTypeBuckets> typeBuckets;
+};
@@ -1,70 +1,296 @@
 #include <stdio.h>
 
-#include <vtkDataSetAttributes.h> // for vtkDataSetAttributes
-#include <vtkDoubleArray.h>
-#include <vtkGenericDataArray.txx> // for vtkGenericDataArray::InsertNextValue
-#include <vtkIntArray.h> // for vtkIntArray
+#include <algorithm> // for min
+#include <cstring>   // for memcpy
+#include <vtkArrayDispatch.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkIdList.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkPoints.h>   // for vtkPoints
 #include <vtkPolyData.h> // for vtkPolyData
 #include <vtkProgrammableFilter.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
 #include <vtkType.h>              // for vtkIdType
 
 #include "ParticleTypeFilter.hxx"
 
-void FilterType(void *arguments) {
-  ParticleTypeFilterParams *input =
-      static_cast<ParticleTypeFilterParams *>(arguments);
+namespace {
+
+// The mask bits which decide whether a point passes a filter
+const uint16_t SIGNATURE_BITS = static_cast<uint16_t>(Selector::ALL) |
+                                static_cast<uint16_t>(Selector::NONE);
+
+// The signature bits packed densely (0b10 -> bit 0, bits 5 to 9 -> bits 1
+// to 5, NONE -> bit 6), so a chunk can count its points per signature in a
+// small table
+const int NUM_CODES = 128;
+
+int SignatureCode(uint16_t signature) {
+  return ((signature >> 1) & 0b1) | (((signature >> 5) & 0b11111) << 1) |
+         (((signature >> 11) & 0b1) << 6);
+}
+
+uint16_t SignatureOfCode(int code) {
+  return static_cast<uint16_t>(((code & 0b1) << 1) |
+                               (((code >> 1) & 0b11111) << 5) |
+                               (((code >> 6) & 0b1) << 11));
+}
+
+// Points per chunk of the compaction, both passes use the same chunks
+const vtkIdType CHUNK_SIZE = 1 << 16;
+
+// Copies the tuples ids[k] of src to k of dst in parallel, dst is allocated
+struct GatherWorker {
+  const vtkIdType *ids;
+  vtkIdType num;
+
+  template <typename SrcArrayT, typename DstArrayT>
+  void operator()(SrcArrayT *src, DstArrayT *dst) {
+    const auto in = vtk::DataArrayTupleRange(src);
+    auto out = vtk::DataArrayTupleRange(dst);
+    auto gather = [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType k = begin; k < end; k++) {
+        out[k] = in[ids[k]];
+      }
+    };
+    vtkSMPTools::For(0, num, gather);
+  }
+};
+
+struct SignatureWorker {
+  std::vector<uint16_t> *signatures;
+
+  template <typename ArrayT> void operator()(ArrayT *mask) {
+    signatures->resize(mask->GetNumberOfTuples());
+    uint16_t *out = signatures->data();
+    auto classify = [&](vtkIdType begin, vtkIdType end) {
+      const auto range = vtk::DataArrayValueRange<1>(mask, begin, end);
+      uint16_t *o = out + begin;
+      for (auto value : range) {
+        *o++ = TypeSignature(static_cast<uint16_t>(value));
+      }
+    };
+    vtkSMPTools::For(0, mask->GetNumberOfTuples(), classify);
+  }
+};
+
+} // namespace
+
+uint16_t TypeSignature(uint16_t mask) {
+  return mask & SIGNATURE_BITS;
+}
+
+std::shared_ptr<ParticleTypeBuckets> BuildParticleTypeBuckets(vtkPolyData *data) {
+  std::vector<uint16_t> signatures;
+
+  vtkDataArray *mask = data->GetPointData()->GetArray("mask");
+  SignatureWorker worker{&signatures};
+  if (!vtkArrayDispatch::Dispatch::Execute(mask, worker)) {
+    worker(mask);
+  }
+  return BuildParticleTypeBuckets(signatures);
+}
+
+/*
+  Stream compaction in three steps: every chunk counts its points per
+  signature (in parallel), the counts are prefix summed into the offset of
+  every chunk within each bucket, and the chunks scatter their indices to
+  these offsets (in parallel). The buckets are allocated exactly once and
+  keep the points in ascending order.
+*/
+std::shared_ptr<ParticleTypeBuckets>
+BuildParticleTypeBuckets(const std::vector<uint16_t> &signatures) {
+  auto buckets = std::make_shared<ParticleTypeBuckets>();
+
+  vtkIdType numPts = static_cast<vtkIdType>(signatures.size());
+  vtkIdType numChunks = (numPts + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  const uint16_t *sigs = signatures.data();
+
+  // counts[chunk * NUM_CODES + code]
+  std::vector<vtkIdType> counts(numChunks * NUM_CODES, 0);
+  auto count = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType c = begin; c < end; c++) {
+      vtkIdType *chunkCounts = counts.data() + c * NUM_CODES;
+      vtkIdType last = std::min(numPts, (c + 1) * CHUNK_SIZE);
+      for (vtkIdType i = c * CHUNK_SIZE; i < last; i++) {
+        chunkCounts[SignatureCode(sigs[i])]++;
+      }
+    }
+  };
+  vtkSMPTools::For(0, numChunks, 1, count);
+
+  // One bucket per occurring signature, ordered by signature code. The
+  // counts turn into the offsets of the chunks within their bucket.
+  int bucketOf[NUM_CODES];
+  for (int code = 0; code < NUM_CODES; code++) {
+    vtkIdType total = 0;
+    for (vtkIdType c = 0; c < numChunks; c++) {
+      vtkIdType n = counts[c * NUM_CODES + code];
+      counts[c * NUM_CODES + code] = total;
+      total += n;
+    }
+
+    bucketOf[code] = -1;
+    if (total > 0) {
+      bucketOf[code] = static_cast<int>(buckets->signatures.size());
+      buckets->signatures.push_back(SignatureOfCode(code));
+      buckets->indices.emplace_back(total);
+    }
+  }
+
+  std::vector<vtkIdType *> bucketData(NUM_CODES, nullptr);
+  for (int code = 0; code < NUM_CODES; code++) {
+    if (bucketOf[code] >= 0) {
+      bucketData[code] = buckets->indices[bucketOf[code]].data();
+    }
+  }
 
-  vtkPoints *inPts = input->data->GetPoints();
-  vtkIdType numPts = inPts->GetNumberOfPoints();
-
-  vtkIntArray *mask =
-      static_cast<vtkIntArray *>(input->data->GetPointData()->GetArray("mask"));
-  vtkDoubleArray *rho = static_cast<vtkDoubleArray *>(
-      input->data->GetPointData()->GetArray("rho"));
-  vtkDoubleArray *mass = static_cast<vtkDoubleArray *>(
-      input->data->GetPointData()->GetArray("mass"));
-  vtkDoubleArray *temperature = static_cast<vtkDoubleArray *>(
-      input->data->GetPointData()->GetArray("Temperature"));
-
-  vtkNew<vtkUnsignedCharArray> hiddenPoints;
-  hiddenPoints->SetName(vtkDataSetAttributes::GhostArrayName());
-  hiddenPoints->SetNumberOfValues(numPts);
-  hiddenPoints->Fill(0);
-
-  // Based on the filter do stuff
-  size_t num = 0;
+  auto scatter = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType c = begin; c < end; c++) {
+      vtkIdType *offsets = counts.data() + c * NUM_CODES;
+      vtkIdType last = std::min(numPts, (c + 1) * CHUNK_SIZE);
+      for (vtkIdType i = c * CHUNK_SIZE; i < last; i++) {
+        int code = SignatureCode(sigs[i]);
+        bucketData[code][offsets[code]++] = i;
+      }
+    }
+  };
+  vtkSMPTools::For(0, numChunks, 1, scatter);
+
+  return buckets;
+}
+
+bool IsTypeSelected(uint16_t signature, uint16_t filter) {
   uint16_t all_mask = static_cast<uint16_t>(Selector::ALL);
-  uint16_t mask_filter = static_cast<uint16_t>(input->current_filter);
-  double pos[3];
-  if ((input->current_filter & all_mask) == all_mask) {
-    // keep all particles as is
-    printf("[ParticleFilter]: ALL filter is active, Number of points: %lld\n",
-           inPts->GetNumberOfPoints());
+  if ((filter & all_mask) == all_mask) {
+    return true;
+  }
+  return (signature & filter) ||
+         ((filter & static_cast<uint16_t>(Selector::DARK_MATTER)) &&
+          ((signature & 0b10) == 0) &&
+          static_cast<uint16_t>(Selector::DARK_AGN) != filter);
+}
 
-    for (vtkIdType i = 0; i < numPts; i++) {
-      uint16_t this_mask = static_cast<uint16_t>(mask->GetTuple1(i));
-      input->data->GetPoints()->GetPoint(i, pos);
+vtkSmartPointer<vtkIdList>
+CollectBuckets(const ParticleTypeBuckets &buckets,
+               const std::function<bool(uint16_t)> &selected) {
+  // Offset of every selected bucket in the list
+  std::vector<size_t> selectedBuckets;
+  std::vector<vtkIdType> offsets;
+  vtkIdType num = 0;
+  for (size_t b = 0; b < buckets.signatures.size(); b++) {
+    if (selected(buckets.signatures[b])) {
+      selectedBuckets.push_back(b);
+      offsets.push_back(num);
+      num += static_cast<vtkIdType>(buckets.indices[b].size());
+    }
+  }
+
+  vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
+  ids->SetNumberOfIds(num);
+  vtkIdType *out = ids->GetPointer(0);
+  auto copy = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType s = begin; s < end; s++) {
+      const std::vector<vtkIdType> &bucket =
+          buckets.indices[selectedBuckets[s]];
+      memcpy(out + offsets[s], bucket.data(),
+             bucket.size() * sizeof(vtkIdType));
+    }
+  };
+  vtkSMPTools::For(0, static_cast<vtkIdType>(selectedBuckets.size()), 1,
+                   copy);
+  return ids;
+}
+
+vtkSmartPointer<vtkPolyData>
+ExtractPoints(vtkPolyData *data, vtkIdList *ids,
+              const std::vector<const char *> *arrays) {
+  vtkIdType num = ids->GetNumberOfIds();
+
+  vtkPointData *inPD = data->GetPointData();
+  std::vector<vtkDataArray *> sources{data->GetPoints()->GetData()};
+  if (arrays == nullptr) {
+    for (int i = 0; i < inPD->GetNumberOfArrays(); i++) {
+      if (inPD->GetArray(i) != nullptr) {
+        sources.push_back(inPD->GetArray(i));
+      }
     }
   } else {
-    for (vtkIdType i = 0; i < numPts; i++) {
-      uint16_t this_mask = static_cast<uint16_t>(mask->GetTuple1(i));
-      input->data->GetPoints()->GetPoint(i, pos);
-
-      if (((this_mask & mask_filter) ||
-           ((mask_filter & (static_cast<uint16_t>(Selector::DARK_MATTER))) &&
-            ((this_mask & 0b10) == 0)) &&
-               static_cast<uint16_t>(Selector::DARK_AGN) != mask_filter)) {
-        num++;
-      } else {
-        hiddenPoints->SetValue(i, vtkDataSetAttributes::HIDDENPOINT);
+    for (const char *name : *arrays) {
+      if (inPD->GetArray(name) != nullptr) {
+        sources.push_back(inPD->GetArray(name));
       }
     }
-    printf("[ParticleFilter]: Number of points: %ld\n", num);
   }
+  std::vector<vtkSmartPointer<vtkDataArray>> gathered(sources.size());
+
+  // The arrays are preallocated to the exact size and each one is copied
+  // by all threads
+  GatherWorker worker{ids->GetPointer(0), num};
+  for (size_t a = 0; a < sources.size(); a++) {
+    vtkDataArray *source = sources[a];
+    vtkSmartPointer<vtkDataArray> arr =
+        vtkSmartPointer<vtkDataArray>::Take(source->NewInstance());
+    arr->SetName(source->GetName());
+    arr->SetNumberOfComponents(source->GetNumberOfComponents());
+    arr->SetNumberOfTuples(num);
+    if (!vtkArrayDispatch::Dispatch2SameValueType::Execute(source, arr,
+                                                           worker)) {
+      worker(source, arr.Get());
+    }
+    gathered[a] = arr;
+  }
+
+  vtkSmartPointer<vtkPolyData> subset = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetData(gathered[0]);
+  subset->SetPoints(points);
+  for (size_t a = 1; a < gathered.size(); a++) {
+    subset->GetPointData()->AddArray(gathered[a]);
+  }
+  return subset;
+}
+
+/*
+  Passes only the points of the selected types on, so hidden points are
+  neither glyphed nor uploaded. The cost is linear in the number of visible
+  points since the points are taken from the prebuilt buckets.
+*/
+void FilterType(void *arguments) {
+  ParticleTypeFilterParams *input =
+      static_cast<ParticleTypeFilterParams *>(arguments);
+  vtkPolyData *output = input->filter->GetPolyDataOutput();
+
+  vtkIdType numPts = input->data->GetNumberOfPoints();
+
+  // Without prebuilt buckets (e.g. data which did not come from the
+  // loader) they are built for this execution only
+  std::shared_ptr<ParticleTypeBuckets> ownBuckets;
+  const ParticleTypeBuckets *buckets = input->buckets;
+  if (buckets == nullptr) {
+    ownBuckets = BuildParticleTypeBuckets(input->data);
+    buckets = ownBuckets.get();
+  }
+
+  uint16_t mask_filter = static_cast<uint16_t>(input->current_filter);
+  vtkSmartPointer<vtkIdList> visible =
+      CollectBuckets(*buckets, [mask_filter](uint16_t signature) {
+        return IsTypeSelected(signature, mask_filter);
+      });
+  vtkIdType num = visible->GetNumberOfIds();
+
+  if (num == numPts) {
+    // keep all particles as is
+    printf("[ParticleFilter]: ALL filter is active, Number of points: %lld\n",
+           numPts);
+    output->ShallowCopy(input->data);
+    return;
+  }
+
+  printf("[ParticleFilter]: Number of points: %lld\n", num);
 
-  input->filter->GetPolyDataOutput()->ShallowCopy(input->data);
-  input->filter->GetPolyDataOutput()->GetPointData()->AddArray(hiddenPoints);
+  output->ShallowCopy(ExtractPoints(input->data, visible));
 }
@@ -1,14 +1,55 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
 
+#include <vtkSmartPointer.h>
+#include <vtkType.h> // for vtkIdType
+
+class vtkIdList;
 class vtkPolyData;
 class vtkProgrammableFilter;
 
+/*
+  Indices of the points of a snapshot, grouped by the mask bits the
+  Selector looks at. Built once per snapshot, so a filter change only
+  concatenates the buckets of the selected types.
+*/
+struct ParticleTypeBuckets {
+  std::vector<uint16_t> signatures;
+  std::vector<std::vector<vtkIdType>> indices;
+};
+
+std::shared_ptr<ParticleTypeBuckets> BuildParticleTypeBuckets(vtkPolyData *data);
+std::shared_ptr<ParticleTypeBuckets>
+BuildParticleTypeBuckets(const std::vector<uint16_t> &signatures);
+
+// The mask bits of a point which decide whether it passes a filter
+uint16_t TypeSignature(uint16_t mask);
+
+// Whether points with the given mask bits pass the filter
+bool IsTypeSelected(uint16_t signature, uint16_t filter);
+
+// Ids of the points in all buckets whose signature is selected
+vtkSmartPointer<vtkIdList>
+CollectBuckets(const ParticleTypeBuckets &buckets,
+               const std::function<bool(uint16_t)> &selected);
+
+// Copies the given points with the named point arrays (all arrays if
+// arrays is null) into a new vtkPolyData. The arrays are allocated to the
+// exact size and every array is copied in parallel.
+vtkSmartPointer<vtkPolyData>
+ExtractPoints(vtkPolyData *data, vtkIdList *ids,
+              const std::vector<const char *> *arrays = nullptr);
+
 struct ParticleTypeFilterParams {
   vtkPolyData *data;
   vtkProgrammableFilter *filter;
   uint16_t current_filter;
+  // Buckets of data
+  const ParticleTypeBuckets *buckets;
 };
 
 void FilterType(void *arguments);
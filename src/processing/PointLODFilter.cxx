@@ -0,0 +1,358 @@
+#include <algorithm> // for max, min, lower_bound, sort
+#include <cmath>     // for floor, sqrt, tan
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <vtkArrayDispatch.h>
+#include <vtkCamera.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkIdList.h>
+#include <vtkIndent.h> // for vtkIndent
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+
+#include "ParticleTypeFilter.hxx"
+#include "PointLODFilter.hxx"
+
+namespace {
+
+// Bits of the Morton code per axis, the deepest nodes are 1/1024 of the
+// bounds wide
+const int MAX_DEPTH = 10;
+
+// Spreads the lower 10 bits of v to every third bit
+inline uint32_t Spread(uint32_t v) {
+  v &= 0x3ff;
+  v = (v | (v << 16)) & 0x030000ff;
+  v = (v | (v << 8)) & 0x0300f00f;
+  v = (v | (v << 4)) & 0x030c30c3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+// Sort key of every point: its Morton code in the upper and its index in
+// the lower 32 bits
+struct MortonWorker {
+  std::vector<uint64_t> *keys;
+  const double *lo;
+  double size;
+
+  template <typename ArrayT> void operator()(ArrayT *points) {
+    const double scale = (1 << MAX_DEPTH) / size;
+    auto encode = [&](vtkIdType begin, vtkIdType end) {
+      const auto range = vtk::DataArrayTupleRange<3>(points, begin, end);
+      vtkIdType i = begin;
+      for (const auto p : range) {
+        uint32_t code = 0;
+        for (int a = 0; a < 3; a++) {
+          int c = static_cast<int>(std::floor((p[a] - lo[a]) * scale));
+          c = std::max(0, std::min(c, (1 << MAX_DEPTH) - 1));
+          code |= Spread(static_cast<uint32_t>(c)) << a;
+        }
+        (*keys)[i] = (static_cast<uint64_t>(code) << 32) | static_cast<uint64_t>(i);
+        i++;
+      }
+    };
+    vtkSMPTools::For(0, points->GetNumberOfTuples(), encode);
+  }
+};
+
+} // namespace
+
+vtkStandardNewMacro(PointLODFilter);
+
+PointLODFilter::PointLODFilter() {
+  this->SetNumberOfInputPorts(1);
+  this->SetNumberOfOutputPorts(1);
+}
+
+PointLODFilter::~PointLODFilter() {}
+
+void PointLODFilter::PrintSelf(ostream &os, vtkIndent indent) {
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "PointBudget: " << this->pointBudget << "\n";
+  os << indent << "SamplesPerNode: " << this->samplesPerNode << "\n";
+  os << indent << "Nodes: " << this->nodes.size() << "\n";
+}
+
+void PointLODFilter::SetRenderer(vtkRenderer *renderer) {
+  if (this->renderer != renderer) {
+    this->renderer = renderer;
+    this->Modified();
+  }
+}
+
+void PointLODFilter::SetPointBudget(vtkIdType budget) {
+  budget = std::max<vtkIdType>(budget, 1);
+  if (this->pointBudget != budget) {
+    this->pointBudget = budget;
+    this->Modified();
+  }
+}
+
+vtkIdType PointLODFilter::GetPointBudget() {
+  return this->pointBudget;
+}
+
+void PointLODFilter::SetSamplesPerNode(vtkIdType samples) {
+  samples = std::max<vtkIdType>(samples, 1);
+  if (this->samplesPerNode != samples) {
+    this->samplesPerNode = samples;
+    // The leaves depend on it
+    this->treeInput = nullptr;
+    this->Modified();
+  }
+}
+
+void PointLODFilter::BuildTree(vtkPolyData *input) {
+  this->treeInput = input;
+  this->treeInputTime = input->GetMTime();
+  this->nodes.clear();
+
+  vtkIdType n = input->GetNumberOfPoints();
+  this->order.resize(n);
+  this->codes.resize(n);
+  if (n == 0 || input->GetPoints() == nullptr) {
+    return;
+  }
+
+  // Cube around the points
+  double bounds[6];
+  input->GetBounds(bounds);
+  Node root;
+  root.size = 0;
+  for (int a = 0; a < 3; a++) {
+    root.lo[a] = bounds[2 * a];
+    root.size = std::max(root.size, bounds[2 * a + 1] - bounds[2 * a]);
+  }
+  // Points on the upper faces stay in the last cell
+  root.size = std::max(root.size, 1e-6) * (1 + 1e-6);
+  root.begin = 0;
+  root.end = n;
+
+  std::vector<uint64_t> keys(n);
+  vtkDataArray *points = input->GetPoints()->GetData();
+  MortonWorker worker{&keys, root.lo, root.size};
+  if (!vtkArrayDispatch::Dispatch::Execute(points, worker)) {
+    worker(points);
+  }
+  vtkSMPTools::Sort(keys.begin(), keys.end());
+
+  auto split = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType k = begin; k < end; k++) {
+      this->codes[k] = static_cast<uint32_t>(keys[k] >> 32);
+      this->order[k] = static_cast<vtkIdType>(keys[k] & 0xffffffffu);
+    }
+  };
+  vtkSMPTools::For(0, n, split);
+
+  this->nodes.push_back(root);
+  this->BuildNode(0, 0);
+}
+
+void PointLODFilter::BuildNode(int index, int depth) {
+  Node node = this->nodes[index];
+  if (node.end - node.begin <= this->samplesPerNode || depth == MAX_DEPTH) {
+    return;
+  }
+
+  // The codes within the node share all bits above the ones of its children
+  const int shift = 3 * (MAX_DEPTH - depth - 1);
+  const uint32_t prefix = (this->codes[node.begin] >> (shift + 3)) << (shift + 3);
+  const auto first = this->codes.begin() + node.begin;
+  const auto last = this->codes.begin() + node.end;
+
+  std::vector<Node> children;
+  for (uint32_t c = 0; c < 8; c++) {
+    Node child;
+    child.size = 0.5 * node.size;
+    for (int a = 0; a < 3; a++) {
+      child.lo[a] = node.lo[a] + ((c >> a) & 1) * child.size;
+    }
+    child.begin = std::lower_bound(first, last, prefix + (c << shift)) -
+                  this->codes.begin();
+    child.end = std::lower_bound(first, last, prefix + ((c + 1) << shift)) -
+                this->codes.begin();
+    if (child.begin < child.end) {
+      children.push_back(child);
+    }
+  }
+
+  int firstChild = static_cast<int>(this->nodes.size());
+  this->nodes[index].firstChild = firstChild;
+  this->nodes[index].numChildren = static_cast<int>(children.size());
+  this->nodes.insert(this->nodes.end(), children.begin(), children.end());
+  for (int c = 0; c < static_cast<int>(children.size()); c++) {
+    this->BuildNode(firstChild + c, depth + 1);
+  }
+}
+
+bool PointLODFilter::Select(std::vector<Selected> &selected) {
+  selected.clear();
+  if (this->renderer == nullptr || this->nodes.empty() ||
+      this->nodes[0].end <= this->pointBudget) {
+    return false;
+  }
+
+  vtkCamera *camera = this->renderer->GetActiveCamera();
+  double planes[24];
+  camera->GetFrustumPlanes(this->renderer->GetTiledAspectRatio(), planes);
+  double position[3];
+  camera->GetPosition(position);
+  const int *size = this->renderer->GetSize();
+  // Pixels per unit of length at distance 1 (perspective) or everywhere
+  // (parallel projection)
+  double pixelScale =
+      camera->GetParallelProjection()
+          ? size[1] / (2 * camera->GetParallelScale())
+          : size[1] / (2 * std::tan(vtkMath::RadiansFromDegrees(
+                               0.5 * camera->GetViewAngle())));
+
+  auto visible = [&](const Node &node) {
+    // Only the four sides, the near and far planes follow the shown bounds
+    for (int p = 0; p < 4; p++) {
+      const double *plane = planes + 4 * p;
+      double d = plane[3];
+      for (int a = 0; a < 3; a++) {
+        d += plane[a] * (node.lo[a] + (plane[a] > 0 ? node.size : 0));
+      }
+      if (d < 0) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto pixels = [&](const Node &node) {
+    if (camera->GetParallelProjection()) {
+      return node.size * pixelScale;
+    }
+    double d2 = 0;
+    for (int a = 0; a < 3; a++) {
+      double d = node.lo[a] + 0.5 * node.size - position[a];
+      d2 += d * d;
+    }
+    // Distance to the bounding sphere
+    double distance = std::sqrt(d2) - 0.87 * node.size;
+    return node.size * pixelScale / std::max(distance, 1e-3 * node.size);
+  };
+  const vtkIdType samples = std::min(this->samplesPerNode, this->pointBudget);
+  auto stride = [&](const Node &node) {
+    return (node.end - node.begin + samples - 1) / samples;
+  };
+  auto drawn = [&](const Node &node) {
+    vtkIdType s = stride(node);
+    return (node.end - node.begin + s - 1) / s;
+  };
+
+  // Largest nodes on screen first
+  std::priority_queue<std::pair<double, int>> queue;
+  vtkIdType total = 0;
+  if (visible(this->nodes[0])) {
+    queue.push({pixels(this->nodes[0]), 0});
+    total = drawn(this->nodes[0]);
+  }
+
+  while (!queue.empty()) {
+    std::pair<double, int> top = queue.top();
+    queue.pop();
+    const Node &node = this->nodes[top.second];
+
+    bool refine = node.firstChild >= 0 && top.first >= 1.0;
+    vtkIdType extra = -drawn(node);
+    if (refine) {
+      for (int c = 0; c < node.numChildren; c++) {
+        const Node &child = this->nodes[node.firstChild + c];
+        if (visible(child)) {
+          extra += drawn(child);
+        }
+      }
+      refine = total + extra <= this->pointBudget;
+    }
+    if (!refine) {
+      selected.push_back({top.second, stride(node)});
+      continue;
+    }
+
+    total += extra;
+    for (int c = 0; c < node.numChildren; c++) {
+      const Node &child = this->nodes[node.firstChild + c];
+      if (visible(child)) {
+        queue.push({pixels(child), node.firstChild + c});
+      }
+    }
+  }
+
+  std::sort(selected.begin(), selected.end(),
+            [](const Selected &a, const Selected &b) { return a.node < b.node; });
+  return true;
+}
+
+bool PointLODFilter::UpdateSelection() {
+  // A new input executes the filter anyway
+  vtkPolyData *input = vtkPolyData::SafeDownCast(this->GetInputDataObject(0, 0));
+  if (input == nullptr || input != this->treeInput ||
+      input->GetMTime() != this->treeInputTime) {
+    return false;
+  }
+
+  std::vector<Selected> selected;
+  bool all = !this->Select(selected);
+  if (all == this->selectAll && selected == this->selection) {
+    return false;
+  }
+  this->Modified();
+  return true;
+}
+
+int PointLODFilter::RequestData(vtkInformation *vtkNotUsed(request),
+                                vtkInformationVector **inputVector,
+                                vtkInformationVector *outputVector) {
+  vtkPolyData *input = vtkPolyData::GetData(inputVector[0]);
+  vtkPolyData *output = vtkPolyData::GetData(outputVector);
+
+  if (input != this->treeInput || input->GetMTime() != this->treeInputTime) {
+    this->BuildTree(input);
+  }
+
+  this->selectAll = !this->Select(this->selection);
+  if (this->selectAll) {
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  // Every selected node writes its points behind the ones before it
+  std::vector<vtkIdType> offsets(this->selection.size() + 1, 0);
+  for (size_t s = 0; s < this->selection.size(); s++) {
+    const Node &node = this->nodes[this->selection[s].node];
+    vtkIdType stride = this->selection[s].stride;
+    offsets[s + 1] = offsets[s] + (node.end - node.begin + stride - 1) / stride;
+  }
+
+  vtkNew<vtkIdList> ids;
+  ids->SetNumberOfIds(offsets.back());
+  vtkIdType *out = ids->GetPointer(0);
+  auto gather = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType s = begin; s < end; s++) {
+      const Node &node = this->nodes[this->selection[s].node];
+      vtkIdType o = offsets[s];
+      for (vtkIdType k = node.begin; k < node.end; k += this->selection[s].stride) {
+        out[o++] = this->order[k];
+      }
+    }
+  };
+  vtkSMPTools::For(0, static_cast<vtkIdType>(this->selection.size()), 1,
+                   gather);
+
+  output->ShallowCopy(ExtractPoints(input, ids));
+  return 1;
+}
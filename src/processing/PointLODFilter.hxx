@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd> // for ostream
+#include <vector>
+
+#include <vtkIOStream.h> // for ostream
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSetGet.h> // for vtkTypeMacro
+#include <vtkType.h>   // for vtkIdType, vtkMTimeType
+
+class vtkIndent;
+class vtkInformation;
+class vtkInformationVector;
+class vtkPolyData;
+class vtkRenderer;
+
+/*
+  Level of detail for large point sets: passes on at most a budget of
+  points, chosen by what the camera of the renderer sees.
+
+  The points of the input are sorted along a Morton curve and an octree is
+  built over them (once per input), so every node is a contiguous range of
+  the sorted points. Every n-th point of such a range is a representative
+  subsample of the node, evenly spread over it.
+
+  A node inside the view frustum is drawn with up to SamplesPerNode points.
+  Starting from the root, the node which covers the most pixels is
+  replaced by its children as long as the budget allows it. Near nodes get
+  refined down to all of their points while far away ones stay coarse, the
+  output never has more than PointBudget points.
+
+  Call UpdateSelection() before rendering (e.g. on the StartEvent of the
+  renderer), it only marks the filter modified when other nodes are
+  visible than in the output, so a still camera re-executes nothing.
+*/
+class PointLODFilter : public vtkPolyDataAlgorithm {
+public:
+  static PointLODFilter *New();
+  vtkTypeMacro(PointLODFilter, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent) override;
+
+  // The renderer whose camera decides the nodes, not owned. Without one all
+  // points are passed on.
+  void SetRenderer(vtkRenderer *renderer);
+
+  // Most points in the output
+  void SetPointBudget(vtkIdType budget);
+  vtkIdType GetPointBudget();
+
+  // Points drawn of a node which is not refined further
+  void SetSamplesPerNode(vtkIdType samples);
+
+  // Selects the nodes for the current camera, returns true (and marks the
+  // filter modified) if they differ from the ones of the output
+  bool UpdateSelection();
+
+protected:
+  PointLODFilter();
+  ~PointLODFilter() override;
+
+  int RequestData(vtkInformation *request, vtkInformationVector **inputVector,
+                  vtkInformationVector *outputVector) override;
+
+private:
+  PointLODFilter(const PointLODFilter &);      // Not implemented.
+  void operator=(const PointLODFilter &); // Not implemented.
+
+  struct Node {
+    double lo[3];
+    double size;
+    // Range of the node in order
+    vtkIdType begin;
+    vtkIdType end;
+    // Children are stored next to each other, -1 for leaves
+    int firstChild = -1;
+    int numChildren = 0;
+  };
+
+  // A node in the output and every how many of its points are drawn
+  struct Selected {
+    int node;
+    vtkIdType stride;
+
+    bool operator==(const Selected &other) const {
+      return node == other.node && stride == other.stride;
+    }
+  };
+
+  vtkRenderer *renderer = nullptr;
+  vtkIdType pointBudget = 2000000;
+  vtkIdType samplesPerNode = 4096;
+
+  // Octree of the input it was built for
+  vtkPolyData *treeInput = nullptr;
+  vtkMTimeType treeInputTime = 0;
+  std::vector<vtkIdType> order;
+  std::vector<uint32_t> codes;
+  std::vector<Node> nodes;
+
+  // Nodes of the last output, all points when empty
+  std::vector<Selected> selection;
+  bool selectAll = true;
+
+  void BuildTree(vtkPolyData *input);
+  void BuildNode(int index, int depth);
+  // Returns false if all points are passed on
+  bool Select(std::vector<Selected> &selected);
+};
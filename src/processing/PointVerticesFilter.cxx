@@ -0,0 +1,77 @@
+#include <limits>
+
+#include <vtkCellArray.h>
+#include <vtkIndent.h> // for vtkIndent
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkType.h> // for vtkIdType
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include "PointVerticesFilter.hxx"
+
+namespace {
+
+// Offsets 0..n and connectivity 0..n-1, i.e. vertex i is point i
+template <typename ArrayT>
+vtkSmartPointer<vtkCellArray> BuildVertices(vtkIdType n) {
+  vtkNew<ArrayT> offsets;
+  vtkNew<ArrayT> connectivity;
+  offsets->SetNumberOfValues(n + 1);
+  connectivity->SetNumberOfValues(n);
+  auto *o = offsets->GetPointer(0);
+  auto *c = connectivity->GetPointer(0);
+
+  auto fill = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; i++) {
+      o[i] = static_cast<typename ArrayT::ValueType>(i);
+      c[i] = static_cast<typename ArrayT::ValueType>(i);
+    }
+  };
+  vtkSMPTools::For(0, n, fill);
+  o[n] = static_cast<typename ArrayT::ValueType>(n);
+
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  cells->SetData(offsets, connectivity);
+  return cells;
+}
+
+} // namespace
+
+vtkStandardNewMacro(PointVerticesFilter);
+
+PointVerticesFilter::PointVerticesFilter() {
+  this->SetNumberOfInputPorts(1);
+  this->SetNumberOfOutputPorts(1);
+}
+
+PointVerticesFilter::~PointVerticesFilter() {}
+
+void PointVerticesFilter::PrintSelf(ostream &os, vtkIndent indent) {
+  this->Superclass::PrintSelf(os, indent);
+}
+
+int PointVerticesFilter::RequestData(vtkInformation *vtkNotUsed(request),
+                                     vtkInformationVector **inputVector,
+                                     vtkInformationVector *outputVector) {
+  vtkPolyData *input = vtkPolyData::GetData(inputVector[0]);
+  vtkPolyData *output = vtkPolyData::GetData(outputVector);
+
+  vtkIdType n = input->GetNumberOfPoints();
+  if (this->vertices == nullptr || this->vertices->GetNumberOfCells() != n) {
+    this->vertices = n < std::numeric_limits<vtkTypeInt32>::max()
+                         ? BuildVertices<vtkTypeInt32Array>(n)
+                         : BuildVertices<vtkTypeInt64Array>(n);
+  }
+
+  output->Initialize();
+  output->SetPoints(input->GetPoints());
+  output->GetPointData()->PassData(input->GetPointData());
+  output->SetVerts(this->vertices);
+  return 1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <iosfwd> // for ostream
+
+#include <vtkIOStream.h> // for ostream
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSetGet.h> // for vtkTypeMacro
+#include <vtkSmartPointer.h>
+
+class vtkCellArray;
+class vtkIndent;
+class vtkInformation;
+class vtkInformationVector;
+
+/*
+  Makes the points of the input renderable as vertices without copying
+  them: the output shares the vtkPoints and all point arrays of the input
+  and only gets one vertex cell per point.
+
+  Replaces vtkGlyph3D with a one point source, which copies every point and
+  all its arrays. The vertex cells are stored with 32 bit ids and kept for
+  the next execution, they are rebuilt only when the number of points
+  changes.
+*/
+class PointVerticesFilter : public vtkPolyDataAlgorithm {
+public:
+  static PointVerticesFilter *New();
+  vtkTypeMacro(PointVerticesFilter, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent) override;
+
+protected:
+  PointVerticesFilter();
+  ~PointVerticesFilter() override;
+
+  int RequestData(vtkInformation *request, vtkInformationVector **inputVector,
+                  vtkInformationVector *outputVector) override;
+
+private:
+  PointVerticesFilter(const PointVerticesFilter &); // Not implemented.
+  void operator=(const PointVerticesFilter &);      // Not implemented.
+
+  vtkSmartPointer<vtkCellArray> vertices;
+};
@@ -0,0 +1,469 @@
+#include <algorithm> // for max, min
+#include <atomic>
+#include <cmath> // for ceil, floor, round, sqrt
+#include <utility>
+#include <vector>
+
+#include <vtkArrayDispatch.h>
+#include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkDataObject.h>
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkIndent.h> // for vtkIndent
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkType.h> // for vtkIdType
+
+#include "../data/SpatialIndex.hxx"
+#include "SPHSplatAlgorithm.hxx"
+
+namespace {
+
+// Edge length of the simulation box in Mpc/h, positions wrap around
+const double BOX_SIZE = 64.0;
+
+// Support of the quintic kernel in smoothing lengths and its normalisation
+// in 3D (the same as vtkSPHQuinticKernel)
+const double CUTOFF = 3.0;
+const double SIGMA = 1.0 / (120.0 * vtkMath::Pi());
+
+// z slices per slab, every slab is filled by one task
+const int SLAB_SLICES = 2;
+
+// Particles per task when looking for the particles within the box
+const vtkIdType CHUNK_SIZE = 1 << 16;
+
+inline double Pow5(double x) {
+  double x2 = x * x;
+  return x2 * x2 * x;
+}
+
+// Unnormalised quintic kernel for q = r / h < 3
+inline double Quintic(double q) {
+  double w = Pow5(3 - q);
+  if (q < 2) {
+    w -= 6 * Pow5(2 - q);
+  }
+  if (q < 1) {
+    w += 15 * Pow5(1 - q);
+  }
+  return w;
+}
+
+// A particle whose support overlaps the voxels to compute
+struct Splat {
+  // Position relative to the origin of the box
+  double pos[3];
+  double h;
+  // mass * SIGMA / h^3
+  double weight;
+  // Voxels within the support (inclusive)
+  int lo[3];
+  int hi[3];
+};
+
+struct Box {
+  int dimensions[3];
+  double origin[3];
+  double spacing[3];
+  double minSmoothingLength;
+  double defaultSmoothingLength;
+  // Voxels kept from the last execution (inclusive), cleanLo > cleanHi if
+  // there are none. Only the voxels outside of them are computed.
+  int cleanLo[3];
+  int cleanHi[3];
+
+  bool IsClean(int d, int index) const {
+    return index >= cleanLo[d] && index <= cleanHi[d];
+  }
+};
+
+// Finds the particles whose support overlaps the voxels to compute, in
+// parallel chunks
+struct CandidateWorker {
+  const Box *box;
+  bool hasSmoothingLength;
+  // The particles to look at, all of them without ids
+  const std::vector<vtkIdType> *ids = nullptr;
+  std::vector<std::vector<Splat>> chunks;
+
+  template <typename PointsArrayT, typename MassArrayT, typename HHArrayT>
+  void operator()(PointsArrayT *points, MassArrayT *mass, HHArrayT *hh) {
+    const vtkIdType numPts = ids != nullptr
+                                 ? static_cast<vtkIdType>(ids->size())
+                                 : points->GetNumberOfTuples();
+    const vtkIdType numChunks = (numPts + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks.assign(numChunks, std::vector<Splat>());
+
+    auto find = [&](vtkIdType begin, vtkIdType end) {
+      const auto pos = vtk::DataArrayTupleRange<3>(points);
+      const auto masses = vtk::DataArrayValueRange<1>(mass);
+      const auto lengths = vtk::DataArrayValueRange<1>(hh);
+
+      for (vtkIdType c = begin; c < end; c++) {
+        vtkIdType last = std::min(numPts, (c + 1) * CHUNK_SIZE);
+        for (vtkIdType n = c * CHUNK_SIZE; n < last; n++) {
+          vtkIdType p = ids != nullptr ? (*ids)[n] : n;
+          Splat splat;
+          splat.h = hasSmoothingLength
+                        ? static_cast<double>(lengths[p])
+                        : box->defaultSmoothingLength;
+          // Smaller kernels could fall between the voxel centers
+          splat.h = std::max(splat.h, box->minSmoothingLength);
+          double support = CUTOFF * splat.h;
+
+          bool inside = true;
+          bool clean = true;
+          for (int d = 0; d < 3 && inside; d++) {
+            double length = box->spacing[d] * (box->dimensions[d] - 1);
+            // Nearest periodic image relative to the center of the box
+            double x = pos[p][d] - box->origin[d] - 0.5 * length;
+            x -= BOX_SIZE * std::round(x / BOX_SIZE);
+            x += 0.5 * length;
+
+            splat.pos[d] = x;
+            splat.lo[d] = std::max(
+                0, static_cast<int>(std::ceil((x - support) / box->spacing[d])));
+            splat.hi[d] = std::min(
+                box->dimensions[d] - 1,
+                static_cast<int>(std::floor((x + support) / box->spacing[d])));
+            inside = splat.lo[d] <= splat.hi[d];
+            clean = clean && box->IsClean(d, splat.lo[d]) &&
+                    box->IsClean(d, splat.hi[d]);
+          }
+          // Entirely within the reused voxels
+          if (!inside || clean) {
+            continue;
+          }
+
+          splat.weight = masses[p] * SIGMA / (splat.h * splat.h * splat.h);
+          chunks[c].push_back(splat);
+        }
+      }
+    };
+    vtkSMPTools::For(0, numChunks, 1, find);
+  }
+};
+
+// Slot in the ring of every index of the box along one axis
+std::vector<vtkIdType> RingSlots(long long start, int dimension,
+                                 vtkIdType stride) {
+  std::vector<vtkIdType> slots(dimension);
+  for (int i = 0; i < dimension; i++) {
+    long long slot = (start + i) % dimension;
+    slots[i] = (slot < 0 ? slot + dimension : slot) * stride;
+  }
+  return slots;
+}
+
+using CandidateDispatch =
+    vtkArrayDispatch::Dispatch3ByValueType<vtkArrayDispatch::Reals,
+                                           vtkArrayDispatch::Reals,
+                                           vtkArrayDispatch::Reals>;
+
+} // namespace
+
+vtkStandardNewMacro(SPHSplatAlgorithm);
+
+SPHSplatAlgorithm::SPHSplatAlgorithm() {
+  this->SetNumberOfInputPorts(1);
+  this->SetNumberOfOutputPorts(1);
+}
+
+SPHSplatAlgorithm::~SPHSplatAlgorithm() {}
+
+void SPHSplatAlgorithm::PrintSelf(ostream &os, vtkIndent indent) {
+  this->Superclass::PrintSelf(os, indent);
+}
+
+void SPHSplatAlgorithm::SetDimensions(const int dimensions[3]) {
+  if (!std::equal(dimensions, dimensions + 3, this->dimensions)) {
+    std::copy(dimensions, dimensions + 3, this->dimensions);
+    this->ringValid = false;
+    this->Modified();
+  }
+}
+
+void SPHSplatAlgorithm::SetOrigin(const double origin[3]) {
+  if (!std::equal(origin, origin + 3, this->origin)) {
+    std::copy(origin, origin + 3, this->origin);
+    this->Modified();
+  }
+}
+
+void SPHSplatAlgorithm::SetVolumeLengths(const double lengths[3]) {
+  if (!std::equal(lengths, lengths + 3, this->volumeLengths)) {
+    std::copy(lengths, lengths + 3, this->volumeLengths);
+    this->ringValid = false;
+    this->Modified();
+  }
+}
+
+void SPHSplatAlgorithm::SetDefaultSmoothingLength(double length) {
+  if (this->defaultSmoothingLength != length) {
+    this->defaultSmoothingLength = length;
+    this->ringValid = false;
+    this->Modified();
+  }
+}
+
+void SPHSplatAlgorithm::GetLatticeStart(long long start[3]) {
+  for (int d = 0; d < 3; d++) {
+    double spacing = this->volumeLengths[d] / this->dimensions[d];
+    start[d] = std::llround(this->origin[d] / spacing);
+  }
+}
+
+void SPHSplatAlgorithm::SetSpatialIndex(
+    std::shared_ptr<const SpatialIndex> index) {
+  if (this->spatialIndex != index) {
+    this->spatialIndex = std::move(index);
+    this->Modified();
+  }
+}
+
+void SPHSplatAlgorithm::SetAbortCheck(std::function<bool()> check) {
+  // Not a parameter of the output, so no Modified()
+  this->abortCheck = std::move(check);
+}
+
+bool SPHSplatAlgorithm::WasAborted() {
+  return this->aborted;
+}
+
+int SPHSplatAlgorithm::FillInputPortInformation(int vtkNotUsed(port),
+                                                vtkInformation *info) {
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  return 1;
+}
+
+int SPHSplatAlgorithm::RequestInformation(
+    vtkInformation *vtkNotUsed(request),
+    vtkInformationVector **vtkNotUsed(inputVector),
+    vtkInformationVector *outputVector) {
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  int extent[6] = {0, this->dimensions[0] - 1, 0, this->dimensions[1] - 1,
+                   0, this->dimensions[2] - 1};
+  long long start[3];
+  this->GetLatticeStart(start);
+  double spacing[3];
+  double origin[3];
+  for (int d = 0; d < 3; d++) {
+    spacing[d] = this->volumeLengths[d] / this->dimensions[d];
+    origin[d] = start[d] * spacing[d];
+  }
+
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+  outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+  outInfo->Set(vtkDataObject::ORIGIN(), origin, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_FLOAT, 1);
+  return 1;
+}
+
+int SPHSplatAlgorithm::RequestData(vtkInformation *vtkNotUsed(request),
+                                   vtkInformationVector **inputVector,
+                                   vtkInformationVector *outputVector) {
+  vtkPolyData *input = vtkPolyData::GetData(inputVector[0]);
+  vtkImageData *output = vtkImageData::GetData(outputVector);
+  this->aborted = false;
+
+  long long start[3];
+  this->GetLatticeStart(start);
+
+  Box box;
+  std::copy(this->dimensions, this->dimensions + 3, box.dimensions);
+  for (int d = 0; d < 3; d++) {
+    box.spacing[d] = this->volumeLengths[d] / this->dimensions[d];
+    box.origin[d] = start[d] * box.spacing[d];
+  }
+  box.minSmoothingLength =
+      0.5 * std::max({box.spacing[0], box.spacing[1], box.spacing[2]});
+  box.defaultSmoothingLength = this->defaultSmoothingLength;
+
+  // The voxels of the last execution which are still in the box
+  const vtkIdType numVoxels = static_cast<vtkIdType>(box.dimensions[0]) *
+                              box.dimensions[1] * box.dimensions[2];
+  bool reuse = this->ringValid && this->ringInput == input &&
+               this->ringInputTime == input->GetMTime() &&
+               static_cast<vtkIdType>(this->ring.size()) == numVoxels;
+  for (int d = 0; d < 3; d++) {
+    long long shift = this->ringStart[d] - start[d];
+    box.cleanLo[d] = static_cast<int>(std::max(0ll, shift));
+    box.cleanHi[d] = static_cast<int>(
+        std::min<long long>(box.dimensions[d] - 1, shift + box.dimensions[d] - 1));
+    reuse = reuse && box.cleanLo[d] <= box.cleanHi[d];
+  }
+  if (!reuse) {
+    this->ring.assign(numVoxels, 0.0f);
+    for (int d = 0; d < 3; d++) {
+      box.cleanLo[d] = 0;
+      box.cleanHi[d] = -1;
+    }
+  }
+
+  std::vector<vtkIdType> slotX = RingSlots(start[0], box.dimensions[0], 1);
+  std::vector<vtkIdType> slotY =
+      RingSlots(start[1], box.dimensions[1], box.dimensions[0]);
+  std::vector<vtkIdType> slotZ = RingSlots(
+      start[2], box.dimensions[2],
+      static_cast<vtkIdType>(box.dimensions[0]) * box.dimensions[1]);
+  float *voxels = this->ring.data();
+
+  // Clear the newly exposed voxels
+  if (reuse) {
+    auto clear = [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType k = begin; k < end; k++) {
+        for (int j = 0; j < box.dimensions[1]; j++) {
+          bool rowClean = box.IsClean(2, k) && box.IsClean(1, j);
+          float *row = voxels + slotZ[k] + slotY[j];
+          for (int i = 0; i < box.dimensions[0]; i++) {
+            if (!rowClean || !box.IsClean(0, i)) {
+              row[slotX[i]] = 0.0f;
+            }
+          }
+        }
+      }
+    };
+    vtkSMPTools::For(0, box.dimensions[2], clear);
+  }
+
+  vtkDataArray *mass = input->GetPointData()->GetArray("mass");
+  if (input->GetPoints() != nullptr && mass != nullptr) {
+    vtkDataArray *hh = input->GetPointData()->GetArray("hh");
+
+    CandidateWorker worker;
+    worker.box = &box;
+    worker.hasSmoothingLength = hh != nullptr;
+
+    // Only the particles whose largest possible support reaches the box
+    std::vector<vtkIdType> ids;
+    if (this->spatialIndex &&
+        this->spatialIndex->GetNumberOfPoints() == input->GetNumberOfPoints()) {
+      double maxH = std::max(box.minSmoothingLength, box.defaultSmoothingLength);
+      if (hh != nullptr) {
+        // The range is cached by the array
+        maxH = std::max(box.minSmoothingLength, hh->GetRange(0)[1]);
+      }
+      double lo[3];
+      double hi[3];
+      for (int d = 0; d < 3; d++) {
+        lo[d] = box.origin[d] - CUTOFF * maxH;
+        hi[d] = box.origin[d] + this->volumeLengths[d] + CUTOFF * maxH;
+      }
+      ids = this->spatialIndex->FindPointsInBox(lo, hi);
+      worker.ids = &ids;
+    }
+    vtkDataArray *points = input->GetPoints()->GetData();
+    vtkDataArray *lengths = hh != nullptr ? hh : mass;
+    if (!CandidateDispatch::Execute(points, mass, lengths, worker)) {
+      worker(points, mass, lengths);
+    }
+
+    // Every slab gets the particles overlapping its slices
+    std::vector<Splat> splats;
+    for (std::vector<Splat> &chunk : worker.chunks) {
+      splats.insert(splats.end(), chunk.begin(), chunk.end());
+    }
+    const int numSlabs = (box.dimensions[2] + SLAB_SLICES - 1) / SLAB_SLICES;
+    std::vector<std::vector<const Splat *>> slabs(numSlabs);
+    for (const Splat &splat : splats) {
+      for (int s = splat.lo[2] / SLAB_SLICES; s <= splat.hi[2] / SLAB_SLICES;
+           s++) {
+        slabs[s].push_back(&splat);
+      }
+    }
+
+    std::atomic<bool> abort{false};
+    auto fill = [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType s = begin; s < end; s++) {
+        if (abort || (this->abortCheck && this->abortCheck())) {
+          abort = true;
+          return;
+        }
+        int firstSlice = static_cast<int>(s) * SLAB_SLICES;
+        int lastSlice =
+            std::min(box.dimensions[2] - 1, firstSlice + SLAB_SLICES - 1);
+
+        for (const Splat *splat : slabs[s]) {
+          double invH = 1.0 / splat->h;
+          int k0 = std::max(splat->lo[2], firstSlice);
+          int k1 = std::min(splat->hi[2], lastSlice);
+
+          for (int k = k0; k <= k1; k++) {
+            double dz = k * box.spacing[2] - splat->pos[2];
+            for (int j = splat->lo[1]; j <= splat->hi[1]; j++) {
+              double dy = j * box.spacing[1] - splat->pos[1];
+              double ryz = dy * dy + dz * dz;
+              bool rowClean = box.IsClean(2, k) && box.IsClean(1, j);
+              float *row = voxels + slotZ[k] + slotY[j];
+
+              for (int i = splat->lo[0]; i <= splat->hi[0]; i++) {
+                if (rowClean && box.IsClean(0, i)) {
+                  continue;
+                }
+                double dx = i * box.spacing[0] - splat->pos[0];
+                double q = std::sqrt(dx * dx + ryz) * invH;
+                if (q < CUTOFF) {
+                  row[slotX[i]] += static_cast<float>(splat->weight * Quintic(q));
+                }
+              }
+            }
+          }
+        }
+      }
+    };
+    vtkSMPTools::For(0, numSlabs, 1, fill);
+    this->aborted = abort;
+  }
+
+  // The ring is only partially filled
+  if (this->aborted) {
+    this->ringValid = false;
+    return 1;
+  }
+
+  std::copy(start, start + 3, this->ringStart);
+  this->ringValid = true;
+  this->ringInput = input;
+  this->ringInputTime = input->GetMTime();
+
+  // Unroll the ring into the image, every row in at most two pieces
+  output->SetExtent(0, box.dimensions[0] - 1, 0, box.dimensions[1] - 1, 0,
+                    box.dimensions[2] - 1);
+  output->SetSpacing(box.spacing);
+  output->SetOrigin(box.origin);
+
+  // New scalars every execution, so shallow copies of earlier outputs
+  // (e.g. on screen) stay untouched
+  vtkNew<vtkFloatArray> rho;
+  rho->SetName("rho");
+  rho->SetNumberOfTuples(numVoxels);
+  output->GetPointData()->SetScalars(rho);
+  float *image = rho->GetPointer(0);
+
+  const int dimX = box.dimensions[0];
+  const int wrapAt = dimX - static_cast<int>(slotX[0]);
+  auto unroll = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType k = begin; k < end; k++) {
+      for (int j = 0; j < box.dimensions[1]; j++) {
+        const float *row = voxels + slotZ[k] + slotY[j];
+        float *out = image + (k * box.dimensions[1] + j) * dimX;
+        std::copy(row + slotX[0], row + dimX, out);
+        std::copy(row, row + slotX[0], out + wrapAt);
+      }
+    }
+  };
+  vtkSMPTools::For(0, box.dimensions[2], unroll);
+
+  return 1;
+}
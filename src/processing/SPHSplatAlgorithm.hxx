@@ -0,0 +1,103 @@
+#pragma once
+
+#include <functional>
+#include <iosfwd> // for ostream
+#include <memory>
+#include <vector>
+
+#include <vtkIOStream.h> // for ostream
+#include <vtkImageAlgorithm.h>
+#include <vtkSetGet.h> // for vtkTypeMacro
+
+class SpatialIndex;
+class vtkIndent;
+class vtkInformation;
+class vtkInformationVector;
+class vtkPolyData;
+
+/*
+  Deposits the baryons (vtkPolyData with "mass" and "hh") onto a box of
+  voxels with the SPH quintic kernel:
+
+    rho(x) = sum_j mass_j * W(|x - x_j|, hh_j)
+
+  This is the density vtkSPHInterpolator computes for "rho", but every
+  particle is scattered once into the voxels within its support instead of
+  searching the neighbours of every voxel. The output is an implicit
+  vtkImageData with the point scalars "rho", the voxel (i, j, k) sits at
+  origin + (i, j, k) * volumeLengths / dimensions.
+
+  The particles are sorted into slabs of z slices and the slabs are filled
+  in parallel, every slab by one thread, so no voxel is written
+  concurrently. Positions are wrapped into the periodic box around it.
+
+  The origin is snapped to the lattice of voxels (multiples of the
+  spacing) and the voxels are kept in a ring buffer indexed by their
+  lattice position modulo the dimensions. When only the origin moved by
+  less than the box, the overlapping voxels are reused and only the newly
+  exposed slabs are splatted, so the box can follow the camera.
+
+  With a spatial index of the input only the particles near the box are
+  looked at instead of all of them.
+*/
+class SPHSplatAlgorithm : public vtkImageAlgorithm {
+public:
+  static SPHSplatAlgorithm *New();
+  vtkTypeMacro(SPHSplatAlgorithm, vtkImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent) override;
+
+  void SetDimensions(const int dimensions[3]);
+  void SetOrigin(const double origin[3]);
+  void SetVolumeLengths(const double lengths[3]);
+
+  // Smoothing length for inputs without "hh", in Mpc/h
+  void SetDefaultSmoothingLength(double length);
+
+  // Index over the points of the input, ignored if it does not match it
+  void SetSpatialIndex(std::shared_ptr<const SpatialIndex> index);
+
+  // Called between the slabs, if it returns true the execution stops and
+  // leaves a partial volume. Lets another thread cancel a running update.
+  void SetAbortCheck(std::function<bool()> check);
+  // Whether the last execution was stopped by the abort check
+  bool WasAborted();
+
+protected:
+  SPHSplatAlgorithm();
+  ~SPHSplatAlgorithm() override;
+
+  int FillInputPortInformation(int port, vtkInformation *info) override;
+
+  int RequestInformation(vtkInformation *request,
+                         vtkInformationVector **inputVector,
+                         vtkInformationVector *outputVector) override;
+
+  int RequestData(vtkInformation *request, vtkInformationVector **inputVector,
+                  vtkInformationVector *outputVector) override;
+
+private:
+  SPHSplatAlgorithm(const SPHSplatAlgorithm &); // Not implemented.
+  void operator=(const SPHSplatAlgorithm &);    // Not implemented.
+
+  // Lattice index of the first voxel of the box with the current origin
+  void GetLatticeStart(long long start[3]);
+
+  int dimensions[3] = {140, 140, 140};
+  double origin[3] = {0, 0, 0};
+  double volumeLengths[3] = {2, 2, 2};
+  double defaultSmoothingLength = 0.04;
+
+  std::shared_ptr<const SpatialIndex> spatialIndex;
+  std::function<bool()> abortCheck;
+  bool aborted = false;
+
+  // The voxels of the last execution, voxel (i, j, k) of the lattice is at
+  // ((k % dz) * dy + j % dy) * dx + i % dx
+  std::vector<float> ring;
+  // Lattice index of the first voxel in the ring
+  long long ringStart[3] = {0, 0, 0};
+  // The ring is reused only for the same input and the same parameters
+  bool ringValid = false;
+  vtkPolyData *ringInput = nullptr;
+  vtkMTimeType ringInputTime = 0;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+  SIMD level of the CPU, checked once at runtime. The kernels are compiled
+  for each level with __attribute__((target(...))), so the build needs no
+  -march and the binary still runs on CPUs without AVX.
+*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VISCOS_X86_SIMD
+#endif
+
+enum class SimdLevel { SCALAR, AVX2, AVX512 };
+
+inline SimdLevel DetectSimd() {
+#ifdef VISCOS_X86_SIMD
+  static const SimdLevel level = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return SimdLevel::AVX2;
+    }
+    return SimdLevel::SCALAR;
+  }();
+  return level;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+inline const char *SimdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::AVX512:
+    return "AVX-512";
+  case SimdLevel::AVX2:
+    return "AVX2";
+  default:
+    return "scalar";
+  }
+}
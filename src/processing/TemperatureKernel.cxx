@@ -0,0 +1,159 @@
+#include <algorithm> // for min
+#include <cmath>     // for pow, log10
+
+#include "Simd.hxx"
+#include "TemperatureKernel.hxx"
+
+namespace {
+
+template <typename T>
+void ScaleScalar(const T *uu, vtkIdType n, double factor, double *out) {
+  for (vtkIdType i = 0; i < n; i++) {
+    out[i] = factor * uu[i];
+  }
+}
+
+#ifdef VISCOS_X86_SIMD
+
+__attribute__((target("avx2"))) void
+ScaleAVX2(const float *uu, vtkIdType n, double factor, double *out) {
+  const __m256d f = _mm256_set1_pd(factor);
+  vtkIdType i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(uu + i);
+    __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+    __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(lo, f));
+    _mm256_storeu_pd(out + i + 4, _mm256_mul_pd(hi, f));
+  }
+  ScaleScalar(uu + i, n - i, factor, out + i);
+}
+
+__attribute__((target("avx2"))) void
+ScaleAVX2(const double *uu, vtkIdType n, double factor, double *out) {
+  const __m256d f = _mm256_set1_pd(factor);
+  vtkIdType i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(uu + i), f));
+  }
+  ScaleScalar(uu + i, n - i, factor, out + i);
+}
+
+__attribute__((target("avx512f"))) void
+ScaleAVX512(const float *uu, vtkIdType n, double factor, double *out) {
+  const __m512d f = _mm512_set1_pd(factor);
+  vtkIdType i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512d lo = _mm512_cvtps_pd(_mm256_loadu_ps(uu + i));
+    __m512d hi = _mm512_cvtps_pd(_mm256_loadu_ps(uu + i + 8));
+    _mm512_storeu_pd(out + i, _mm512_mul_pd(lo, f));
+    _mm512_storeu_pd(out + i + 8, _mm512_mul_pd(hi, f));
+  }
+  ScaleScalar(uu + i, n - i, factor, out + i);
+}
+
+__attribute__((target("avx512f"))) void
+ScaleAVX512(const double *uu, vtkIdType n, double factor, double *out) {
+  const __m512d f = _mm512_set1_pd(factor);
+  vtkIdType i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(uu + i), f));
+  }
+  ScaleScalar(uu + i, n - i, factor, out + i);
+}
+
+#endif
+
+template <typename T>
+void Scale(const T *uu, vtkIdType n, double factor, double *out) {
+  switch (DetectSimd()) {
+#ifdef VISCOS_X86_SIMD
+  case SimdLevel::AVX512:
+    ScaleAVX512(uu, n, factor, out);
+    return;
+  case SimdLevel::AVX2:
+    ScaleAVX2(uu, n, factor, out);
+    return;
+#endif
+  default:
+    ScaleScalar(uu, n, factor, out);
+  }
+}
+
+// Reads the temperatures back while they are still in the cache
+void Log10(const double *temperature, vtkIdType n, float *logOut) {
+  for (vtkIdType i = 0; i < n; i++) {
+    logOut[i] = temperature[i] > 0
+                    ? static_cast<float>(std::log10(temperature[i]))
+                    : 0.0f;
+  }
+}
+
+// Chunks small enough for the temperatures to stay in L1 for the log10
+const vtkIdType CHUNK = 4096;
+
+template <typename T>
+void Compute(const T *uu, vtkIdType n, double factor, double *out,
+             float *logOut) {
+  if (logOut == nullptr) {
+    Scale(uu, n, factor, out);
+    return;
+  }
+  for (vtkIdType i = 0; i < n; i += CHUNK) {
+    vtkIdType len = std::min(CHUNK, n - i);
+    Scale(uu + i, len, factor, out + i);
+    Log10(out + i, len, logOut + i);
+  }
+}
+
+// Float output: the chunk is computed in double and rounded while it is
+// still in the cache
+template <typename T>
+void Compute(const T *uu, vtkIdType n, double factor, float *out,
+             float *logOut) {
+  double temperature[CHUNK];
+  for (vtkIdType i = 0; i < n; i += CHUNK) {
+    vtkIdType len = std::min(CHUNK, n - i);
+    Scale(uu + i, len, factor, temperature);
+    for (vtkIdType k = 0; k < len; k++) {
+      out[i + k] = static_cast<float>(temperature[k]);
+    }
+    if (logOut != nullptr) {
+      Log10(temperature, len, logOut + i);
+    }
+  }
+}
+
+} // namespace
+
+double Redshift(double timestep) {
+  return 200 * (1 - timestep / 625);
+}
+
+double TemperatureFactor(double timestep) {
+  return 4.8e5 / std::pow(1.0 + Redshift(timestep), 3);
+}
+
+void ComputeTemperature(const float *uu, vtkIdType n, double factor,
+                        double *out, float *logOut) {
+  Compute(uu, n, factor, out, logOut);
+}
+
+void ComputeTemperature(const double *uu, vtkIdType n, double factor,
+                        double *out, float *logOut) {
+  Compute(uu, n, factor, out, logOut);
+}
+
+void ComputeTemperature(const float *uu, vtkIdType n, double factor,
+                        float *out, float *logOut) {
+  Compute(uu, n, factor, out, logOut);
+}
+
+void ComputeTemperature(const double *uu, vtkIdType n, double factor,
+                        float *out, float *logOut) {
+  Compute(uu, n, factor, out, logOut);
+}
+
+const char *TemperatureKernelName() {
+  return SimdLevelName(DetectSimd());
+}
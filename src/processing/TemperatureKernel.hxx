@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath> // for log10
+
+#include <vtkAOSDataArrayTemplate.h>
+#include <vtkDataArrayRange.h>
+#include <vtkType.h> // for vtkIdType
+
+// Redshift of the timestep (z = 200 at the first and 0 after the last)
+double Redshift(double timestep);
+
+// Factor from the internal energy (uu) to the temperature at the given
+// timestep, hoisted out of the per particle loop
+double TemperatureFactor(double timestep);
+
+/*
+  out[i] = factor * uu[i] and, if logOut is given, logOut[i] = log10(out[i]).
+
+  The raw float and double versions use AVX-512 or AVX2 when the CPU
+  supports it (checked once at runtime) and a scalar loop otherwise. The
+  product is always computed in double, float outputs are rounded after.
+*/
+void ComputeTemperature(const float *uu, vtkIdType n, double factor,
+                        double *out, float *logOut);
+void ComputeTemperature(const double *uu, vtkIdType n, double factor,
+                        double *out, float *logOut);
+void ComputeTemperature(const float *uu, vtkIdType n, double factor,
+                        float *out, float *logOut);
+void ComputeTemperature(const double *uu, vtkIdType n, double factor,
+                        float *out, float *logOut);
+
+// Name of the SIMD instruction set ComputeTemperature uses on this CPU
+const char *TemperatureKernelName();
+
+// The points [begin, end) of a uu array of any storage type. Contiguous
+// float and double arrays go to the SIMD kernels above.
+template <typename ArrayT, typename OutT>
+void ComputeTemperature(ArrayT *uu, vtkIdType begin, vtkIdType end,
+                        double factor, OutT *out, float *logOut) {
+  const auto range = vtk::DataArrayValueRange<1>(uu, begin, end);
+  vtkIdType i = begin;
+  for (auto value : range) {
+    double temperature = factor * value;
+    out[i] = static_cast<OutT>(temperature);
+    if (logOut != nullptr) {
+      logOut[i] = temperature > 0 ? static_cast<float>(std::log10(temperature))
+                                  : 0.0f;
+    }
+    i++;
+  }
+}
+
+template <typename OutT>
+inline void ComputeTemperature(vtkAOSDataArrayTemplate<float> *uu,
+                               vtkIdType begin, vtkIdType end, double factor,
+                               OutT *out, float *logOut) {
+  ComputeTemperature(uu->GetPointer(begin), end - begin, factor, out + begin,
+                     logOut != nullptr ? logOut + begin : nullptr);
+}
+
+template <typename OutT>
+inline void ComputeTemperature(vtkAOSDataArrayTemplate<double> *uu,
+                               vtkIdType begin, vtkIdType end, double factor,
+                               OutT *out, float *logOut) {
+  ComputeTemperature(uu->GetPointer(begin), end - begin, factor, out + begin,
+                     logOut != nullptr ? logOut + begin : nullptr);
+}
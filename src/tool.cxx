@@ -0,0 +1,406 @@
+#include <algorithm> // for min
+#include <chrono>
+#include <cstring> // for memcmp
+#include <filesystem>
+#include <iterator> // for next
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+// IWYU pragma: no_include <bits/chrono.h>
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkGlyph3D.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPointSource.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLPolyDataReader.h>
+
+#include "data/Clustering.hxx"
+#include "data/Loader.h"
+#include "data/Manifest.hxx"
+#include "data/QuantileSketch.hxx"
+#include "data/VTPDecoder.hxx"
+#include "processing/BlendKernel.hxx"
+#include "processing/InterpolateSnapshots.hxx"
+#include "processing/PointVerticesFilter.hxx"
+#include "processing/TemperatureKernel.hxx"
+
+namespace fs = std::filesystem;
+
+// Converts every snapshot of the data folder into its columnar file, with
+// float32 the double columns are stored as floats
+int convert(std::string data_folder_path, bool float32) {
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+  printf("Converting %lu files.\n", files.size());
+
+  for (auto path : files) {
+    fs::path columnar = columnar_snapshot_path(path.second);
+    // A file of the other precision is written again
+    if (columnar_snapshot_is_current(path.second) &&
+        columnar_snapshot_is_float32(columnar) == float32) {
+      printf("Skipping timestep %d, %s is up to date.\n", path.first,
+             columnar.c_str());
+      continue;
+    }
+
+    convert_to_columnar(path.first, path.second, float32);
+    printf("Converted timestep %d to %s\n", path.first, columnar.c_str());
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// Writes the manifest of the data folder, see Manifest.hxx
+int manifest(std::string data_folder_path) {
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+  printf("Scanning %lu files.\n", files.size());
+
+  fs::path path = manifest_path(data_folder_path);
+  write_manifest(build_manifest(files), path);
+  printf("Wrote %s\n", path.c_str());
+  return EXIT_SUCCESS;
+}
+
+// Writes the quantile sketches of the arrays of every snapshot, from which
+// the viewer takes its color ranges, see QuantileSketch.hxx
+int sketch(std::string data_folder_path) {
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+  printf("Sketching %lu files.\n", files.size());
+
+  fs::path path = sketches_path(data_folder_path);
+  SketchesWriter writer(path);
+  for (auto file : files) {
+    auto start = std::chrono::steady_clock::now();
+    vtkSmartPointer<vtkPolyData> snapshot =
+        load_snapshot(file.first, file.second);
+    double time =
+        snapshot->GetInformation()->Get(vtkDataObject::DATA_TIME_STEP());
+    SnapshotSketches sketches =
+        sketch_snapshot(snapshot, TemperatureFactor(time));
+    writer.Write(file.first, sketches);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("Sketched %lu arrays of timestep %d in %.2fs\n", sketches.size(),
+           file.first, elapsed.count());
+  }
+  writer.Close();
+
+  printf("Wrote %s\n", path.c_str());
+  return EXIT_SUCCESS;
+}
+
+// Clusters every snapshot (or only the given one) and writes its cluster
+// table
+int cluster(std::string data_folder_path, const ClusteringParams &params,
+            int only_step) {
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+
+  for (auto path : files) {
+    if (only_step >= 0 && path.first != only_step) {
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    // Clustering only needs the positions, the table is keyed by id
+    vtkSmartPointer<vtkPolyData> snapshot =
+        load_snapshot(path.first, path.second, false, {"id"});
+    std::vector<int> labels = find_clusters(snapshot, params);
+
+    fs::path table = cluster_table_path(path.second);
+    write_cluster_table(snapshot, labels, table);
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    printf("Clustered timestep %d into %s (%.1f s)\n", path.first,
+           table.c_str(), seconds);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// Compares how the viewer made the points renderable before (vtkGlyph3D
+// with a one point source) with the vertex cells of PointVerticesFilter
+int bench_vertices(std::string data_folder_path, int only_step) {
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+  auto file = only_step >= 0 ? files.find(only_step) : files.begin();
+  if (file == files.end()) {
+    printf("No snapshot for timestep %d\n", only_step);
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkPolyData> snapshot =
+      load_snapshot(file->first, file->second);
+  printf("Timestep %d: %lld points, %.1f MiB\n", file->first,
+         static_cast<long long>(snapshot->GetNumberOfPoints()),
+         snapshot->GetActualMemorySize() / 1024.0);
+
+  const int runs = 3;
+  auto seconds_since = [](std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  vtkNew<vtkPointSource> point;
+  point->SetRadius(0.0);
+  point->SetNumberOfPoints(1);
+  double glyph_seconds = 0;
+  double glyph_mib = 0;
+  for (int r = 0; r < runs; r++) {
+    vtkNew<vtkGlyph3D> glyph;
+    glyph->SetSourceConnection(point->GetOutputPort());
+    glyph->SetInputData(snapshot);
+    auto start = std::chrono::steady_clock::now();
+    glyph->Update();
+    glyph_seconds += seconds_since(start) / runs;
+    // Everything in the output is a copy
+    glyph_mib = glyph->GetOutput()->GetActualMemorySize() / 1024.0;
+  }
+
+  double vertices_seconds = 0;
+  double vertices_mib = 0;
+  for (int r = 0; r < runs; r++) {
+    vtkNew<PointVerticesFilter> vertices;
+    vertices->SetInputData(snapshot);
+    auto start = std::chrono::steady_clock::now();
+    vertices->Update();
+    vertices_seconds += seconds_since(start) / runs;
+    // Only the vertex cells are new, the points and arrays are shared
+    vertices_mib = vertices->GetOutput()->GetVerts()->GetActualMemorySize() / 1024.0;
+  }
+
+  printf("vtkGlyph3D:          %8.3f s, %8.1f MiB new\n", glyph_seconds,
+         glyph_mib);
+  printf("PointVerticesFilter: %8.3f s, %8.1f MiB new\n", vertices_seconds,
+         vertices_mib);
+  return EXIT_SUCCESS;
+}
+
+// Whether both arrays have the same type, shape and bytes
+bool same_array(vtkDataArray *a, vtkDataArray *b) {
+  if (a == nullptr || b == nullptr) {
+    return a == b;
+  }
+  if (a->GetDataType() != b->GetDataType() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents() ||
+      a->GetNumberOfTuples() != b->GetNumberOfTuples()) {
+    return false;
+  }
+  return memcmp(a->GetVoidPointer(0), b->GetVoidPointer(0),
+                a->GetDataSize() * a->GetDataTypeSize()) == 0;
+}
+
+bool same_snapshot(vtkPolyData *a, vtkPolyData *b) {
+  if (a->GetNumberOfPoints() != b->GetNumberOfPoints() ||
+      a->GetNumberOfCells() != b->GetNumberOfCells() ||
+      !same_array(a->GetPoints() ? a->GetPoints()->GetData() : nullptr,
+                  b->GetPoints() ? b->GetPoints()->GetData() : nullptr)) {
+    return false;
+  }
+  vtkPointData *pa = a->GetPointData();
+  vtkPointData *pb = b->GetPointData();
+  if (pa->GetNumberOfArrays() != pb->GetNumberOfArrays()) {
+    return false;
+  }
+  for (int i = 0; i < pa->GetNumberOfArrays(); i++) {
+    vtkDataArray *array = pa->GetArray(i);
+    if (!same_array(array, pb->GetArray(array->GetName()))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Times vtkXMLPolyDataReader against read_vtp_parallel on one snapshot, the
+// latter with 1, 2, 4, ... threads up to the number of cores
+int bench_vtp(std::string data_folder_path, int only_step) {
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+  auto file = only_step >= 0 ? files.find(only_step) : files.begin();
+  if (file == files.end()) {
+    printf("No snapshot for timestep %d\n", only_step);
+    return EXIT_FAILURE;
+  }
+
+  const int runs = 3;
+  auto seconds_since = [](std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  // The best of the runs, all of them read from the page cache after the
+  // first one
+  vtkSmartPointer<vtkPolyData> stock;
+  double stock_seconds = 0;
+  for (int r = 0; r < runs; r++) {
+    vtkNew<vtkXMLPolyDataReader> reader;
+    reader->SetFileName(file->second.c_str());
+    auto start = std::chrono::steady_clock::now();
+    reader->Update();
+    double seconds = seconds_since(start);
+    stock_seconds = r == 0 ? seconds : std::min(stock_seconds, seconds);
+    stock = reader->GetOutput();
+  }
+  printf("Timestep %d: %lld points, %.1f MiB decoded\n", file->first,
+         static_cast<long long>(stock->GetNumberOfPoints()),
+         stock->GetActualMemorySize() / 1024.0);
+  printf("vtkXMLPolyDataReader:           %8.3f s\n", stock_seconds);
+
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  bool identical = true;
+  for (int threads = 1;; threads = std::min(threads * 2, cores)) {
+    vtkSMPTools::Initialize(threads);
+    double seconds = 0;
+    for (int r = 0; r < runs; r++) {
+      auto start = std::chrono::steady_clock::now();
+      vtkSmartPointer<vtkPolyData> parallel = read_vtp_parallel(file->second);
+      double run = seconds_since(start);
+      seconds = r == 0 ? run : std::min(seconds, run);
+      identical = identical && same_snapshot(stock, parallel);
+    }
+    printf("read_vtp_parallel, %3d threads: %8.3f s (%.1fx)\n", threads,
+           seconds, stock_seconds / seconds);
+    if (threads == cores) {
+      break;
+    }
+  }
+
+  printf("Outputs are %s\n", identical ? "identical" : "DIFFERENT");
+  return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Times InterpolateSnapshots halfway between a snapshot and the next one
+int bench_interpolate(std::string data_folder_path, int only_step) {
+  std::map<int, fs::path> files = load_cosmology_dataset(data_folder_path);
+  auto file = only_step >= 0 ? files.find(only_step) : files.begin();
+  if (file == files.end() || std::next(file) == files.end()) {
+    printf("No snapshot after timestep %d\n", only_step);
+    return EXIT_FAILURE;
+  }
+  auto next = std::next(file);
+
+  vtkSmartPointer<vtkPolyData> a = load_snapshot(file->first, file->second);
+  vtkSmartPointer<vtkPolyData> b = load_snapshot(next->first, next->second);
+  printf("Timesteps %d and %d: %lld and %lld points, blend kernel %s\n",
+         file->first, next->first,
+         static_cast<long long>(a->GetNumberOfPoints()),
+         static_cast<long long>(b->GetNumberOfPoints()), BlendKernelName());
+
+  const int runs = 5;
+  double best = 0;
+  for (int r = 0; r < runs; r++) {
+    auto start = std::chrono::steady_clock::now();
+    vtkSmartPointer<vtkPolyData> blended = InterpolateSnapshots(
+        a, b, 0.5, 0.5 * (file->first + next->first));
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = r == 0 ? elapsed.count() : std::min(best, elapsed.count());
+  }
+  printf("InterpolateSnapshots: %8.3f s\n", best);
+  return EXIT_SUCCESS;
+}
+
+void usage(const char *name) {
+  printf("Usage is %s COMMAND [OPTIONS] DATA_FOLDER_PATH\n", name);
+  printf("Commands:\n");
+  printf("  convert   writes the columnar file of every snapshot\n");
+  printf("  cluster   writes the cluster table of every snapshot\n");
+  printf("  manifest  writes the point counts, ranges and bounds of all "
+         "snapshots\n");
+  printf("  sketch    writes the quantile sketches of the arrays of all "
+         "snapshots (color ranges)\n");
+  printf("  bench-vertices  time and memory of making a snapshot "
+         "renderable, glyphs vs. shared vertices\n");
+  printf("  bench-vtp       time of reading a snapshot, vtkXMLPolyDataReader "
+         "vs. the parallel decoder per thread count\n");
+  printf("  bench-interpolate  time of interpolating halfway between a "
+         "snapshot and the next\n");
+  printf("Options of convert:\n");
+  printf("  --float32          store the double columns as floats\n");
+  printf("Options of cluster:\n");
+  printf("  --dbscan           DBSCAN instead of friends-of-friends\n");
+  printf("  --eps L            linking length / eps in Mpc/h (default 0.2 of "
+         "the mean particle separation)\n");
+  printf("  --min-points N     smallest group (FOF) or neighbours of a core "
+         "point (DBSCAN) (default 20)\n");
+  printf("  --step S           only cluster the given timestep (bench-*: "
+         "the timestep to measure, default the first)\n");
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    usage(argv[0]);
+    return 0;
+  }
+  std::string command = argv[1];
+  std::string data_folder_path;
+
+  ClusteringParams params;
+  int only_step = -1;
+  bool float32 = false;
+
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--float32") {
+      float32 = true;
+    } else if (arg == "--dbscan") {
+      params.algorithm = ClusterAlgorithm::DBSCAN;
+    } else if (arg == "--eps" && i + 1 < argc) {
+      params.linkingLength = atof(argv[++i]);
+    } else if (arg == "--min-points" && i + 1 < argc) {
+      params.minPoints = atoi(argv[++i]);
+    } else if (arg == "--step" && i + 1 < argc) {
+      only_step = atoi(argv[++i]);
+    } else if (data_folder_path.empty() && arg.rfind("--", 0) != 0) {
+      data_folder_path = arg;
+    } else {
+      usage(argv[0]);
+      return 0;
+    }
+  }
+  if (data_folder_path.empty()) {
+    usage(argv[0]);
+    return 0;
+  }
+
+  if (!fs::exists(data_folder_path)) {
+    printf("The data folder path does not exist: %s. It has to contain the *.vtp files.\n", data_folder_path.c_str());
+    return 0;
+  }
+
+  if (command == "convert") {
+    return convert(data_folder_path, float32);
+  }
+  if (command == "manifest") {
+    return manifest(data_folder_path);
+  }
+  if (command == "sketch") {
+    return sketch(data_folder_path);
+  }
+  if (command == "cluster") {
+    return cluster(data_folder_path, params, only_step);
+  }
+  if (command == "bench-vertices") {
+    return bench_vertices(data_folder_path, only_step);
+  }
+  if (command == "bench-interpolate") {
+    return bench_interpolate(data_folder_path, only_step);
+  }
+  if (command == "bench-vtp") {
+    return bench_vtp(data_folder_path, only_step);
+  }
+
+  usage(argv[0]);
+  return 0;
+}